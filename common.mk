@@ -8,6 +8,7 @@ SRC +=	$(COMMON_DIR)/host.c \
 	$(COMMON_DIR)/action_util.c \
 	$(COMMON_DIR)/keymap.c \
 	$(COMMON_DIR)/timer.c \
+	$(COMMON_DIR)/swtimer.c \
 	$(COMMON_DIR)/print.c \
 	$(COMMON_DIR)/bootloader.c \
 	$(COMMON_DIR)/suspend.c \
@@ -39,6 +40,35 @@ else
     OPT_DEFS += -DNO_DEBUG
 endif
 
+ifdef BINLOG_ENABLE
+    SRC += $(COMMON_DIR)/binlog.c
+    OPT_DEFS += -DBINLOG_ENABLE
+endif
+
+# Build-time log level: 0(none) 1(error) 2(warn) 3(info) 4(debug)
+ifdef LOG_LEVEL
+    OPT_DEFS += -DLOG_LEVEL=$(LOG_LEVEL)
+endif
+
+ifdef LOG_LEVEL_ALL_DEBUG
+    OPT_DEFS += -DLOG_LEVEL_ALL_DEBUG
+endif
+
+ifdef LATENCY_ENABLE
+    SRC += $(COMMON_DIR)/latency.c
+    OPT_DEFS += -DLATENCY_ENABLE
+endif
+
+ifdef SCAN_STATS_ENABLE
+    SRC += $(COMMON_DIR)/scan_stats.c
+    OPT_DEFS += -DSCAN_STATS_ENABLE
+endif
+
+ifdef ADAPTIVE_SCAN_ENABLE
+    SRC += $(COMMON_DIR)/adaptive_scan.c
+    OPT_DEFS += -DADAPTIVE_SCAN_ENABLE
+endif
+
 ifdef COMMAND_ENABLE
     SRC += $(COMMON_DIR)/command.c
     OPT_DEFS += -DCOMMAND_ENABLE
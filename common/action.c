@@ -26,8 +26,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "action_macro.h"
 #include "action_util.h"
 #include "action.h"
+#include "latency.h"
 
-#ifdef DEBUG_ACTION
+#include "debug_config.h"
+#if LOG_LEVEL_ACTION >= LOG_LEVEL_DEBUG
 #include "debug.h"
 #else
 #include "nodebug.h"
@@ -37,6 +39,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 void action_exec(keyevent_t event)
 {
     if (!IS_NOEVENT(event)) {
+        latency_mark(LATENCY_ACTION);
         dprint("\n---- action_exec: start -----\n");
         dprint("EVENT: "); debug_event(event); dprintln();
     }
@@ -520,14 +523,14 @@ bool is_tap_key(key_t key)
  */
 void debug_event(keyevent_t event)
 {
-    dprintf("%04X%c(%u)", (event.key.row<<8 | event.key.col), (event.pressed ? 'd' : 'u'), event.time);
+    dlog3("%04X%c(%u)", (event.key.row<<8 | event.key.col), (event.pressed ? 'd' : 'u'), event.time);
 }
 
 void debug_record(keyrecord_t record)
 {
     debug_event(record.event);
 #ifndef NO_ACTION_TAPPING
-    dprintf(":%u%c", record.tap.count, (record.tap.interrupted ? '-' : ' '));
+    dlog2(":%u%c", record.tap.count, (record.tap.interrupted ? '-' : ' '));
 #endif
 }
 
@@ -4,7 +4,8 @@
 #include "util.h"
 #include "action_layer.h"
 
-#ifdef DEBUG_ACTION
+#include "debug_config.h"
+#if LOG_LEVEL_ACTION >= LOG_LEVEL_DEBUG
 #include "debug.h"
 #else
 #include "nodebug.h"
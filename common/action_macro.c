@@ -19,7 +19,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "action_util.h"
 #include "action_macro.h"
 
-#ifdef DEBUG_ACTION
+#include "debug_config.h"
+#if LOG_LEVEL_ACTION >= LOG_LEVEL_DEBUG
 #include "debug.h"
 #else
 #include "nodebug.h"
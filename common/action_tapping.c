@@ -6,7 +6,8 @@
 #include "keycode.h"
 #include "timer.h"
 
-#ifdef DEBUG_ACTION
+#include "debug_config.h"
+#if LOG_LEVEL_TAPPING >= LOG_LEVEL_DEBUG
 #include "debug.h"
 #else
 #include "nodebug.h"
@@ -146,7 +147,7 @@ bool process_tapping(keyrecord_t *keyp)
             // tap_count > 0
             else {
                 if (IS_TAPPING_KEY(event.key) && !event.pressed) {
-                    debug("Tapping: Tap release("); debug_dec(tapping_key.tap.count); debug(")\n");
+                    dlog1("Tapping: Tap release(%u)\n", tapping_key.tap.count);
                     keyp->tap = tapping_key.tap;
                     process_action(keyp);
                     tapping_key = *keyp;
@@ -232,7 +233,7 @@ bool process_tapping(keyrecord_t *keyp)
                         // sequential tap.
                         keyp->tap = tapping_key.tap;
                         if (keyp->tap.count < 15) keyp->tap.count += 1;
-                        debug("Tapping: Tap press("); debug_dec(keyp->tap.count); debug(")\n");
+                        dlog1("Tapping: Tap press(%u)\n", keyp->tap.count);
                         process_action(keyp);
                         tapping_key = *keyp;
                         debug_tapping_key();
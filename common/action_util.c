@@ -19,6 +19,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "action_util.h"
 #include "timer.h"
+#include "swtimer.h"
+#include "util.h"
 
 static inline void add_key_byte(uint8_t code);
 static inline void del_key_byte(uint8_t code);
@@ -30,6 +32,31 @@ static inline void del_key_bit(uint8_t code);
 static uint8_t real_mods = 0;
 static uint8_t weak_mods = 0;
 
+/*
+ * Shadow of keys held in keyboard_report
+ *
+ * key_bits has one bit per keycode and key_count is number of bits on, both are
+ * maintained by add_key/del_key so that membership and has_anykey() don't need
+ * to scan the report. In 6KRO mode key_slots has one bit per occupied keys[] slot.
+ */
+static uint8_t key_bits[32];
+static uint8_t key_count = 0;
+#if REPORT_KEYS > 8
+static uint16_t key_slots = 0;
+#else
+static uint8_t key_slots = 0;
+#endif
+#define KEY_SLOTS_FULL  ((1UL<<REPORT_KEYS) - 1)
+
+#define KEY_BIT_IS_ON(code) (key_bits[(code)>>3] &  (1<<((code)&7)))
+#define KEY_BIT_ON(code)    (key_bits[(code)>>3] |= (1<<((code)&7)))
+#define KEY_BIT_OFF(code)   (key_bits[(code)>>3] &= ~(1<<((code)&7)))
+
+#ifdef NKRO_ENABLE
+/* keyboard_report is laid out in keyboard_report_nkro format, follows keyboard_nkro lazily */
+static void rebuild_keys(bool nkro);
+#endif
+
 
 // TODO: pointer variable is not needed
 //report_keyboard_t keyboard_report = {};
@@ -38,22 +65,28 @@ report_keyboard_t *keyboard_report = &(report_keyboard_t){};
 #ifndef NO_ACTION_ONESHOT
 static int8_t oneshot_mods = 0;
 #if (defined(ONESHOT_TIMEOUT) && (ONESHOT_TIMEOUT > 0))
-static int16_t oneshot_time = 0;
+static void oneshot_timeout(void)
+{
+    log_debug(ACTION, "Oneshot: timeout\n");
+    clear_oneshot_mods();
+    send_keyboard_report();
+}
 #endif
 #endif
 
 
 void send_keyboard_report(void) {
+#ifdef NKRO_ENABLE
+    // keyboard_nkro may be changed by host driver on SET_PROTOCOL, read it once
+    bool nkro = keyboard_nkro;
+    if (keyboard_report_nkro != nkro) {
+        rebuild_keys(nkro);
+    }
+#endif
     keyboard_report->mods  = real_mods;
     keyboard_report->mods |= weak_mods;
 #ifndef NO_ACTION_ONESHOT
     if (oneshot_mods) {
-#if (defined(ONESHOT_TIMEOUT) && (ONESHOT_TIMEOUT > 0))
-        if (TIMER_DIFF_16(timer_read(), oneshot_time) >= ONESHOT_TIMEOUT) {
-            dprintf("Oneshot: timeout\n");
-            clear_oneshot_mods();
-        }
-#endif
         keyboard_report->mods |= oneshot_mods;
         if (has_anykey()) {
             clear_oneshot_mods();
@@ -67,7 +100,7 @@ void send_keyboard_report(void) {
 void add_key(uint8_t key)
 {
 #ifdef NKRO_ENABLE
-    if (keyboard_nkro) {
+    if (keyboard_report_nkro) {
         add_key_bit(key);
         return;
     }
@@ -78,7 +111,7 @@ void add_key(uint8_t key)
 void del_key(uint8_t key)
 {
 #ifdef NKRO_ENABLE
-    if (keyboard_nkro) {
+    if (keyboard_report_nkro) {
         del_key_bit(key);
         return;
     }
@@ -92,6 +125,11 @@ void clear_keys(void)
     for (int8_t i = 1; i < REPORT_SIZE; i++) {
         keyboard_report->raw[i] = 0;
     }
+    for (uint8_t i = 0; i < sizeof(key_bits); i++) {
+        key_bits[i] = 0;
+    }
+    key_count = 0;
+    key_slots = 0;
 }
 
 
@@ -115,14 +153,14 @@ void set_oneshot_mods(uint8_t mods)
 {
     oneshot_mods = mods;
 #if (defined(ONESHOT_TIMEOUT) && (ONESHOT_TIMEOUT > 0))
-    oneshot_time = timer_read();
+    swtimer_set(oneshot_timeout, ONESHOT_TIMEOUT);
 #endif
 }
 void clear_oneshot_mods(void)
 {
     oneshot_mods = 0;
 #if (defined(ONESHOT_TIMEOUT) && (ONESHOT_TIMEOUT > 0))
-    oneshot_time = 0;
+    swtimer_cancel(oneshot_timeout);
 #endif
 }
 #endif
@@ -135,12 +173,7 @@ void clear_oneshot_mods(void)
  */
 uint8_t has_anykey(void)
 {
-    uint8_t cnt = 0;
-    for (uint8_t i = 1; i < REPORT_SIZE; i++) {
-        if (keyboard_report->raw[i])
-            cnt++;
-    }
-    return cnt;
+    return key_count;
 }
 
 uint8_t has_anymod(void)
@@ -151,7 +184,7 @@ uint8_t has_anymod(void)
 uint8_t get_first_key(void)
 {
 #ifdef NKRO_ENABLE
-    if (keyboard_nkro) {
+    if (keyboard_report_nkro) {
         uint8_t i = 0;
         for (; i < REPORT_BITS && !keyboard_report->nkro.bits[i]; i++)
             ;
@@ -166,48 +199,72 @@ uint8_t get_first_key(void)
 /* local functions */
 static inline void add_key_byte(uint8_t code)
 {
-    int8_t i = 0;
-    int8_t empty = -1;
-    for (; i < REPORT_KEYS; i++) {
-        if (keyboard_report->keys[i] == code) {
-            break;
-        }
-        if (empty == -1 && keyboard_report->keys[i] == 0) {
-            empty = i;
-        }
-    }
-    if (i == REPORT_KEYS) {
-        if (empty != -1) {
-            keyboard_report->keys[empty] = code;
-        }
+    if (!code || KEY_BIT_IS_ON(code)) return;
+    if (key_slots == KEY_SLOTS_FULL) {
+        log_warn(ACTION, "add_key_byte: no slot: %02X\n", code);
+        return;
     }
+
+    // lowest free slot
+    uint8_t i = biton16(~key_slots & (key_slots + 1));
+    keyboard_report->keys[i] = code;
+    key_slots |= 1<<i;
+    KEY_BIT_ON(code);
+    key_count++;
 }
 
 static inline void del_key_byte(uint8_t code)
 {
+    if (!code || !KEY_BIT_IS_ON(code)) return;
     for (uint8_t i = 0; i < REPORT_KEYS; i++) {
         if (keyboard_report->keys[i] == code) {
             keyboard_report->keys[i] = 0;
+            key_slots &= ~(1<<i);
+            break;
         }
     }
+    KEY_BIT_OFF(code);
+    key_count--;
 }
 
 #ifdef NKRO_ENABLE
 static inline void add_key_bit(uint8_t code)
 {
+    if (KEY_BIT_IS_ON(code)) return;
     if ((code>>3) < REPORT_BITS) {
         keyboard_report->nkro.bits[code>>3] |= 1<<(code&7);
+        KEY_BIT_ON(code);
+        key_count++;
     } else {
-        dprintf("add_key_bit: can't add: %02X\n", code);
+        log_warn(ACTION, "add_key_bit: can't add: %02X\n", code);
     }
 }
 
 static inline void del_key_bit(uint8_t code)
 {
-    if ((code>>3) < REPORT_BITS) {
-        keyboard_report->nkro.bits[code>>3] &= ~(1<<(code&7));
-    } else {
-        dprintf("del_key_bit: can't del: %02X\n", code);
+    if (!KEY_BIT_IS_ON(code)) return;
+    keyboard_report->nkro.bits[code>>3] &= ~(1<<(code&7));
+    KEY_BIT_OFF(code);
+    key_count--;
+}
+
+/* re-lay keys held in shadow bitmap out in nkro format */
+static void rebuild_keys(bool nkro)
+{
+    uint8_t bits[sizeof(key_bits)];
+    for (uint8_t i = 0; i < sizeof(key_bits); i++) {
+        bits[i] = key_bits[i];
+    }
+
+    clear_keys();
+    keyboard_report_nkro = nkro;
+    log_debug(ACTION, "NKRO: %s\n", nkro ? "on" : "off");
+
+    for (uint8_t i = 0; i < sizeof(bits); i++) {
+        if (!bits[i]) continue;
+        for (uint8_t j = 0; j < 8; j++) {
+            if (bits[i] & (1<<j)) add_key(i<<3 | j);
+        }
     }
 }
 #endif
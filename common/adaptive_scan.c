@@ -0,0 +1,48 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <avr/sleep.h>
+#include "timer.h"
+#include "swtimer.h"
+#include "adaptive_scan.h"
+
+
+static uint32_t last_activity = 0;
+
+
+void adaptive_scan_activity(void)
+{
+    last_activity = timer_read32();
+}
+
+void adaptive_scan_wait(void)
+{
+    if (timer_elapsed32(last_activity) < ADAPTIVE_SCAN_TIMEOUT)
+        return;
+
+    uint16_t wait = swtimer_next_deadline();
+    if (wait > ADAPTIVE_SCAN_INTERVAL) wait = ADAPTIVE_SCAN_INTERVAL;
+    if (!wait) return;
+
+    // Timer0 interrupt wakes up every 1ms
+    uint16_t start = timer_read();
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    while (timer_elapsed(start) < wait) {
+        sleep_enable();
+        sleep_cpu();
+        sleep_disable();
+    }
+}
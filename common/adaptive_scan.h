@@ -0,0 +1,53 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ADAPTIVE_SCAN_H
+#define ADAPTIVE_SCAN_H
+
+#include <stdint.h>
+
+
+/*
+ * Adaptive scan rate
+ *
+ * Matrix is scanned as fast as possible for ADAPTIVE_SCAN_TIMEOUT ms after
+ * last key activity, after that adaptive_scan_wait() puts MCU into idle sleep
+ * for ADAPTIVE_SCAN_INTERVAL ms between scans, limited by next software timer
+ * deadline. Call it after keyboard_task() in main loop.
+ *
+ * First key press after idle waits up to the interval, so it defaults to
+ * 1ms(sleep until next Timer0 tick).
+ */
+#ifndef ADAPTIVE_SCAN_TIMEOUT
+#define ADAPTIVE_SCAN_TIMEOUT   5000
+#endif
+#ifndef ADAPTIVE_SCAN_INTERVAL
+#define ADAPTIVE_SCAN_INTERVAL  1
+#endif
+
+
+#ifdef ADAPTIVE_SCAN_ENABLE
+
+void adaptive_scan_activity(void);
+void adaptive_scan_wait(void);
+
+#else
+
+#define adaptive_scan_activity()
+#define adaptive_scan_wait()
+
+#endif
+
+#endif
@@ -0,0 +1,46 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include "xprintf.h"
+#include "binlog.h"
+
+
+static uint8_t *put16(uint8_t *p, uint16_t v)
+{
+    *p++ = 0x40 | (v & 0x3F);
+    *p++ = 0x40 | ((v >> 6) & 0x3F);
+    *p++ = 0x40 | ((v >> 12) & 0x3F);
+    return p;
+}
+
+/*
+ * Record is built in local buffer and sent with interrupt enabled since
+ * sendchar may wait for host. Output from interrupt can break a record,
+ * decoder resyncs on next SOH.
+ */
+void binlog_write(uint16_t id, uint8_t n, uint16_t a, uint16_t b, uint16_t c)
+{
+    uint8_t buf[1 + 3 * 4];
+    uint8_t *p = buf;
+    *p++ = BINLOG_SOH;
+    p = put16(p, id);
+    if (n > 0) p = put16(p, a);
+    if (n > 1) p = put16(p, b);
+    if (n > 2) p = put16(p, c);
+    for (uint8_t *q = buf; q < p; q++) {
+        xputc(*q);
+    }
+}
@@ -0,0 +1,69 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BINLOG_H
+#define BINLOG_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+
+/*
+ * Deferred binary logging
+ *
+ * Format string is not processed on device. Log record consists of flash
+ * address of the format string as log-site ID and raw 16bit arguments:
+ *
+ *     SOH(0x01), ID, arg0, arg1, arg2
+ *
+ * Each 16bit value is sent as three characters in 0x40-0x7F(6bits each, LSB
+ * first) so that records pass through hid_listen and mix with text output.
+ * Number of arguments is not sent, decoder counts them in format string.
+ *
+ * Table of ID and format string is extracted from symbols '__binlog_fmt.*'
+ * at build time(make binlog) and decoded on host with tool/binlog.py.
+ * Format string is xprintf style and takes only integer arguments.
+ */
+#define BINLOG_SOH  0x01
+
+#define binlog0(fmt)            do { \
+    static const char __binlog_fmt[] PROGMEM = fmt; \
+    binlog_write((uint16_t)__binlog_fmt, 0, 0, 0, 0); \
+} while (0)
+#define binlog1(fmt, a)         do { \
+    static const char __binlog_fmt[] PROGMEM = fmt; \
+    binlog_write((uint16_t)__binlog_fmt, 1, (a), 0, 0); \
+} while (0)
+#define binlog2(fmt, a, b)      do { \
+    static const char __binlog_fmt[] PROGMEM = fmt; \
+    binlog_write((uint16_t)__binlog_fmt, 2, (a), (b), 0); \
+} while (0)
+#define binlog3(fmt, a, b, c)   do { \
+    static const char __binlog_fmt[] PROGMEM = fmt; \
+    binlog_write((uint16_t)__binlog_fmt, 3, (a), (b), (c)); \
+} while (0)
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void binlog_write(uint16_t id, uint8_t n, uint16_t a, uint16_t b, uint16_t c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
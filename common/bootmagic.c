@@ -17,11 +17,24 @@ void bootmagic(void)
         eeconfig_init();
     }
 
-    /* do scans in case of bounce */
-    print("boogmagic scan: ... ");
-    uint8_t scan = 100;
-    while (scan--) { matrix_scan(); _delay_ms(10); }
-    print("done.\n");
+    /* do scans in case of bounce, until matrix settles */
+    print("bootmagic scan: ... ");
+    matrix_row_t matrix_prev[MATRIX_ROWS] = {};
+    uint16_t scan = 0;
+    uint16_t stable = 0;
+    while (stable < BOOTMAGIC_SETTLE_TIME && scan < BOOTMAGIC_SCAN_TIMEOUT) {
+        matrix_scan();
+        stable++;
+        for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+            if (matrix_get_row(r) != matrix_prev[r]) {
+                matrix_prev[r] = matrix_get_row(r);
+                stable = 0;
+            }
+        }
+        _delay_ms(1);
+        scan++;
+    }
+    print("done("); print_dec(scan); print("ms).\n");
 
     /* bootmagic skip */
     if (bootmagic_scan_keycode(BOOTMAGIC_KEY_SKIP)) {
@@ -2,6 +2,27 @@
 #define BOOTMAGIC_H
 
 
+/*
+ * boot scan finishes when matrix is unchanged for BOOTMAGIC_SETTLE_TIME(ms),
+ * which should be longer than debounce time of the board, and gives up after
+ * BOOTMAGIC_SCAN_TIMEOUT(ms) at most.
+ *
+ * Converters define BOOTMAGIC_SLOW_START: the attached keyboard has to power
+ * up before it reports held keys, so they always use the full boot scan.
+ */
+#ifndef BOOTMAGIC_SCAN_TIMEOUT
+#define BOOTMAGIC_SCAN_TIMEOUT          1000
+#endif
+#ifndef BOOTMAGIC_SETTLE_TIME
+#   if defined(BOOTMAGIC_SLOW_START)
+#       define BOOTMAGIC_SETTLE_TIME    BOOTMAGIC_SCAN_TIMEOUT
+#   elif defined(DEBOUNCE) && DEBOUNCE > 5
+#       define BOOTMAGIC_SETTLE_TIME    (DEBOUNCE * 2)
+#   else
+#       define BOOTMAGIC_SETTLE_TIME    10
+#   endif
+#endif
+
 /* bootmagic salt key */
 #ifndef BOOTMAGIC_KEY_SALT
 #define BOOTMAGIC_KEY_SALT              KC_SPACE
@@ -33,11 +33,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "led.h"
 #include "command.h"
 #include "backlight.h"
+#include "latency.h"
+#include "scan_stats.h"
 
 #ifdef MOUSEKEY_ENABLE
 #include "mousekey.h"
 #endif
 
+#ifdef PS2_MOUSE_ENABLE
+#include "ps2_mouse.h"
+#endif
+
 #ifdef PROTOCOL_PJRC
 #   include "usb_keyboard.h"
 #   ifdef EXTRAKEY_ENABLE
@@ -58,12 +64,16 @@ static void command_console_help(void);
 static bool mousekey_console(uint8_t code);
 static void mousekey_console_help(void);
 #endif
+#ifdef PS2_MOUSE_ENABLE
+static bool ps2_mouse_console(uint8_t code);
+static void ps2_mouse_console_help(void);
+#endif
 
 static uint8_t numkey2num(uint8_t code);
 static void switch_default_layer(uint8_t layer);
 
 
-typedef enum { ONESHOT, CONSOLE, MOUSEKEY } cmdstate_t;
+typedef enum { ONESHOT, CONSOLE, MOUSEKEY, PS2_MOUSE } cmdstate_t;
 static cmdstate_t state = ONESHOT;
 
 
@@ -81,6 +91,11 @@ bool command_proc(uint8_t code)
         case MOUSEKEY:
             mousekey_console(code);
             break;
+#endif
+#ifdef PS2_MOUSE_ENABLE
+        case PS2_MOUSE:
+            ps2_mouse_console(code);
+            break;
 #endif
         default:
             state = ONESHOT;
@@ -115,6 +130,13 @@ static void command_common_help(void)
     print("t:	print timer count\n");
     print("s:	print status\n");
     print("e:	print eeprom config\n");
+#ifdef LATENCY_ENABLE
+    print("l:	print & clear latency histogram\n");
+#endif
+#ifdef SCAN_STATS_ENABLE
+    print("r:	print scan rate\n");
+    print("w:	toggle scan rate report every second\n");
+#endif
 #ifdef NKRO_ENABLE
     print("n:	toggle NKRO\n");
 #endif
@@ -288,6 +310,12 @@ static bool command_common(uint8_t code)
 #endif
 #ifdef KEYMAP_SECTION_ENABLE
             " KEYMAP_SECTION"
+#endif
+#ifdef LATENCY_ENABLE
+            " LATENCY"
+#endif
+#ifdef SCAN_STATS_ENABLE
+            " SCAN_STATS"
 #endif
             " " STR(BOOTLOADER_SIZE) "\n");
 
@@ -317,6 +345,24 @@ static bool command_common(uint8_t code)
 #   endif
 #endif
             break;
+#ifdef LATENCY_ENABLE
+        case KC_L:
+            latency_print();
+            latency_clear();
+            break;
+#endif
+#ifdef SCAN_STATS_ENABLE
+        case KC_R:
+            scan_stats_print();
+            break;
+        case KC_W:
+            scan_stats_stream = !scan_stats_stream;
+            if (scan_stats_stream)
+                print("Scan rate report: enabled\n");
+            else
+                print("Scan rate report: disabled\n");
+            break;
+#endif
 #ifdef NKRO_ENABLE
         case KC_N:
             clear_keyboard(); //Prevents stuck keys.
@@ -375,6 +421,9 @@ static void command_console_help(void)
 #ifdef MOUSEKEY_ENABLE
     print("m:	mousekey\n");
 #endif
+#ifdef PS2_MOUSE_ENABLE
+    print("p:	ps2 mouse\n");
+#endif
 }
 
 static bool command_console(uint8_t code)
@@ -396,6 +445,14 @@ static bool command_console(uint8_t code)
             print("M0>");
             state = MOUSEKEY;
             return true;
+#endif
+#ifdef PS2_MOUSE_ENABLE
+        case KC_P:
+            ps2_mouse_console_help();
+            print("\nEnter PS/2 Mouse Console\n");
+            print("P0>");
+            state = PS2_MOUSE;
+            return true;
 #endif
         default:
             print("?");
@@ -421,6 +478,7 @@ static void mousekey_param_print(void)
     print("4: mk_time_to_max: "); pdec(mk_time_to_max); print("\n");
     print("5: mk_wheel_max_speed: "); pdec(mk_wheel_max_speed); print("\n");
     print("6: mk_wheel_time_to_max: "); pdec(mk_wheel_time_to_max); print("\n");
+    print("7: mk_curve: "); pdec(mk_curve); print("\n");
 }
 
 #define PRINT_SET_VAL(v)  print(#v " = "); print_dec(v); print("\n");
@@ -469,6 +527,13 @@ static void mousekey_param_inc(uint8_t param, uint8_t inc)
                 mk_wheel_time_to_max = UINT8_MAX;
             PRINT_SET_VAL(mk_wheel_time_to_max);
             break;
+        case 7:
+            if (mk_curve + inc < MOUSEKEY_CURVE_COUNT)
+                mk_curve += inc;
+            else
+                mk_curve = MOUSEKEY_CURVE_COUNT - 1;
+            PRINT_SET_VAL(mk_curve);
+            break;
     }
 }
 
@@ -517,6 +582,13 @@ static void mousekey_param_dec(uint8_t param, uint8_t dec)
                 mk_wheel_time_to_max = 0;
             PRINT_SET_VAL(mk_wheel_time_to_max);
             break;
+        case 7:
+            if (mk_curve > dec)
+                mk_curve -= dec;
+            else
+                mk_curve = 0;
+            PRINT_SET_VAL(mk_curve);
+            break;
     }
 }
 
@@ -530,13 +602,14 @@ static void mousekey_console_help(void)
     print("4:	select mk_time_to_max\n");
     print("5:	select mk_wheel_max_speed\n");
     print("6:	select mk_wheel_time_to_max\n");
+    print("7:	select mk_curve(0:linear 1:x^1.5 2:x^2 3:x^0.5)\n");
     print("p:	print prameters\n");
     print("d:	set default values\n");
     print("up:	increase prameters(+1)\n");
     print("down:	decrease prameters(-1)\n");
     print("pgup:	increase prameters(+10)\n");
     print("pgdown:	decrease prameters(-10)\n");
-    print("\nspeed = delta * max_speed * (repeat / time_to_max)\n");
+    print("\nspeed = delta * max_speed * curve(repeat / time_to_max)\n");
     print("where delta: cursor="); pdec(MOUSEKEY_MOVE_DELTA);
     print(", wheel="); pdec(MOUSEKEY_WHEEL_DELTA); print("\n");
     print("See http://en.wikipedia.org/wiki/Mouse_keys\n");
@@ -591,6 +664,7 @@ static bool mousekey_console(uint8_t code)
             mk_time_to_max = MOUSEKEY_TIME_TO_MAX;
             mk_wheel_max_speed = MOUSEKEY_WHEEL_MAX_SPEED;
             mk_wheel_time_to_max = MOUSEKEY_WHEEL_TIME_TO_MAX;
+            mk_curve = MOUSEKEY_CURVE;
             print("set default values.\n");
             break;
         default:
@@ -603,6 +677,99 @@ static bool mousekey_console(uint8_t code)
 #endif
 
 
+#ifdef PS2_MOUSE_ENABLE
+/***********************************************************
+ * PS/2 mouse console
+ ***********************************************************/
+static uint8_t ps2_mouse_param = 0;
+
+static void ps2_mouse_param_print(void)
+{
+    print("\n\n----- PS/2 Mouse Parameters -----\n");
+    print("1: pm_sensitivity(/16): "); pdec(pm_sensitivity); print("\n");
+    print("2: pm_accel(/16): "); pdec(pm_accel); print("\n");
+}
+
+static void ps2_mouse_param_add(uint8_t param, int8_t delta)
+{
+    uint8_t *p;
+    uint8_t min = 0;
+    switch (param) {
+        case 1: p = &pm_sensitivity; min = 1; print("pm_sensitivity"); break;
+        case 2: p = &pm_accel; print("pm_accel"); break;
+        default: return;
+    }
+    int16_t v = *p + delta;
+    if (v < min) v = min;
+    if (v > UINT8_MAX) v = UINT8_MAX;
+    *p = v;
+    print(" = "); pdec(*p); print("\n");
+}
+
+static void ps2_mouse_console_help(void)
+{
+    print("\n\n----- PS/2 Mouse Parameters Help -----\n");
+    print("ESC/q:	quit\n");
+    print("1:	select pm_sensitivity(/16)\n");
+    print("2:	select pm_accel(/16)\n");
+    print("p:	print prameters\n");
+    print("d:	set default values\n");
+    print("up:	increase prameters(+1)\n");
+    print("down:	decrease prameters(-1)\n");
+    print("pgup:	increase prameters(+10)\n");
+    print("pgdown:	decrease prameters(-10)\n");
+    print("\nmove = count * sensitivity/16 * (1 + (curve(speed) - 1) * accel/16)\n");
+}
+
+static bool ps2_mouse_console(uint8_t code)
+{
+    switch (code) {
+        case KC_H:
+        case KC_SLASH: /* ? */
+            ps2_mouse_console_help();
+            break;
+        case KC_Q:
+        case KC_ESC:
+            ps2_mouse_param = 0;
+            print("\nQuit PS/2 Mouse Console\n");
+            print("C> ");
+            state = CONSOLE;
+            return false;
+        case KC_P:
+            ps2_mouse_param_print();
+            break;
+        case KC_1:
+        case KC_2:
+            ps2_mouse_param = numkey2num(code);
+            print("selected parameter: "); pdec(ps2_mouse_param); print("\n");
+            break;
+        case KC_UP:
+            ps2_mouse_param_add(ps2_mouse_param, 1);
+            break;
+        case KC_DOWN:
+            ps2_mouse_param_add(ps2_mouse_param, -1);
+            break;
+        case KC_PGUP:
+            ps2_mouse_param_add(ps2_mouse_param, 10);
+            break;
+        case KC_PGDN:
+            ps2_mouse_param_add(ps2_mouse_param, -10);
+            break;
+        case KC_D:
+            pm_sensitivity = PS2_MOUSE_SENSITIVITY;
+            pm_accel = PS2_MOUSE_ACCEL;
+            print("set default values.\n");
+            break;
+        default:
+            print("?");
+            return false;
+    }
+    print("P"); pdec(ps2_mouse_param); print("> ");
+    return true;
+}
+#endif
+
+
 /***********************************************************
  * Utilities
  ***********************************************************/
@@ -29,6 +29,37 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define dprintf(fmt, ...)   do { if (debug_enable) __xprintf(PSTR(fmt), ##__VA_ARGS__); } while (0)
 #define dmsg(s)             dprintf("%s at %s: %S\n", __FILE__, __LINE__, PSTR(s))
 
+/*
+ * Leveled log
+ *     log_debug(MATRIX, "row: %02X\n", row);
+ * Subsystems: MATRIX, ACTION, TAPPING, HOST, MOUSE, PROTOCOL
+ * Error and warning are always printed, info and debug need runtime flag.
+ */
+#define log_enabled(sub, level) (LOG_LEVEL_##sub >= (level))
+#define log_active(sub, level)  (log_enabled(sub, level) && \
+                                 ((level) <= LOG_LEVEL_WARN || LOG_RUNTIME_##sub))
+#define log_print(sub, level, fmt, ...) do { \
+    if (log_active(sub, level)) __xprintf(PSTR(fmt), ##__VA_ARGS__); \
+} while (0)
+#define log_error(sub, fmt, ...)    log_print(sub, LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define log_warn(sub, fmt, ...)     log_print(sub, LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define log_info(sub, fmt, ...)     log_print(sub, LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define log_debug(sub, fmt, ...)    log_print(sub, LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+/* integer arguments only, binary record with BINLOG_ENABLE(see binlog.h) */
+#ifdef BINLOG_ENABLE
+#include "binlog.h"
+#define dlog0(fmt)          do { if (debug_enable) binlog0(fmt); } while (0)
+#define dlog1(fmt, a)       do { if (debug_enable) binlog1(fmt, a); } while (0)
+#define dlog2(fmt, a, b)    do { if (debug_enable) binlog2(fmt, a, b); } while (0)
+#define dlog3(fmt, a, b, c) do { if (debug_enable) binlog3(fmt, a, b, c); } while (0)
+#else
+#define dlog0(fmt)          dprintf(fmt)
+#define dlog1(fmt, a)       dprintf(fmt, a)
+#define dlog2(fmt, a, b)    dprintf(fmt, a, b)
+#define dlog3(fmt, a, b, c) dprintf(fmt, a, b, c)
+#endif
+
 /* DO NOT USE these anymore */
 #define debug(s)                  do { if (debug_enable) print(s); } while (0)
 #define debugln(s)                do { if (debug_enable) print_crlf(); } while (0)
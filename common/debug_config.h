@@ -44,6 +44,70 @@ debug_config_t debug_config;
 #define debug_keyboard  (debug_config.keyboard)
 #define debug_mouse     (debug_config.mouse)
 
+
+/*
+ * Log levels
+ * LOG_LEVEL_<SUBSYSTEM> is build-time minimum level of the subsystem, which
+ * defaults to LOG_LEVEL. Messages of higher level are compiled out with their
+ * strings. Set them in config.h or LOG_LEVEL in Makefile.
+ *
+ * NO_DEBUG removes info and debug only, error and warning are still printed
+ * unless LOG_LEVEL is lowered or NO_PRINT is defined.
+ */
+#define LOG_LEVEL_NONE      0
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_INFO      3
+#define LOG_LEVEL_DEBUG     4
+
+#ifdef LOG_LEVEL_ALL_DEBUG
+/* used by 'make log_report' to get size with all logs */
+#   undef LOG_LEVEL_MATRIX
+#   undef LOG_LEVEL_ACTION
+#   undef LOG_LEVEL_TAPPING
+#   undef LOG_LEVEL_HOST
+#   undef LOG_LEVEL_MOUSE
+#   undef LOG_LEVEL_PROTOCOL
+#   undef LOG_LEVEL
+#   define LOG_LEVEL        LOG_LEVEL_DEBUG
+#   define DEBUG_ACTION
+#endif
+
+#ifndef LOG_LEVEL
+#   define LOG_LEVEL        LOG_LEVEL_DEBUG
+#endif
+#ifndef LOG_LEVEL_MATRIX
+#   define LOG_LEVEL_MATRIX     LOG_LEVEL
+#endif
+/* action debug is off unless DEBUG_ACTION is defined */
+#ifndef LOG_LEVEL_ACTION
+#   if defined(DEBUG_ACTION) || LOG_LEVEL < LOG_LEVEL_INFO
+#       define LOG_LEVEL_ACTION     LOG_LEVEL
+#   else
+#       define LOG_LEVEL_ACTION     LOG_LEVEL_INFO
+#   endif
+#endif
+#ifndef LOG_LEVEL_TAPPING
+#   define LOG_LEVEL_TAPPING    LOG_LEVEL_ACTION
+#endif
+#ifndef LOG_LEVEL_HOST
+#   define LOG_LEVEL_HOST       LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_MOUSE
+#   define LOG_LEVEL_MOUSE      LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_PROTOCOL
+#   define LOG_LEVEL_PROTOCOL   LOG_LEVEL
+#endif
+
+/* runtime flag of subsystem for info and debug level */
+#define LOG_RUNTIME_MATRIX      debug_matrix
+#define LOG_RUNTIME_ACTION      debug_enable
+#define LOG_RUNTIME_TAPPING     debug_enable
+#define LOG_RUNTIME_HOST        debug_keyboard
+#define LOG_RUNTIME_MOUSE       debug_mouse
+#define LOG_RUNTIME_PROTOCOL    debug_enable
+
 #ifdef __cplusplus
 }
 #endif
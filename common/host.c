@@ -16,25 +16,67 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <stdint.h>
+#include <string.h>
 #include <avr/interrupt.h>
 #include "keycode.h"
 #include "host.h"
 #include "util.h"
 #include "debug.h"
+#include "latency.h"
 
 
 #ifdef NKRO_ENABLE
-bool keyboard_nkro = false;
+/* cleared by host driver when host selects boot protocol */
+bool keyboard_nkro = true;
+/* set by action_util.c when it lays report out */
+bool keyboard_report_nkro = false;
 #endif
 
 static host_driver_t *driver;
 static uint16_t last_system_report = 0;
 static uint16_t last_consumer_report = 0;
 
+#ifdef MOUSE_ENABLE
+/*
+ * Mouse reports not accepted by driver are accumulated here and sent later.
+ * Motion is summed into last entry while buttons stay same, button change
+ * starts new entry so that clicks are kept in order. Entry is sent in
+ * pieces of 127 at most until its motion is consumed.
+ *
+ * Queue never waits for host. When it is full a new button state takes slot of
+ * the oldest entry whose buttons are on host already and only rest of motion
+ * remains; the motion is dropped rather than replayed with other buttons. If
+ * no such entry exists host is not polling and the oldest report is dropped.
+ */
+#ifndef HOST_MOUSE_QUEUE_SIZE
+#define HOST_MOUSE_QUEUE_SIZE 4
+#endif
+#if HOST_MOUSE_QUEUE_SIZE < 2
+#error "HOST_MOUSE_QUEUE_SIZE must be 2 or more"
+#endif
+typedef struct {
+    bool sent;
+    uint8_t buttons;
+    int16_t x;
+    int16_t y;
+    int16_t v;
+    int16_t h;
+} mouse_entry_t;
+static mouse_entry_t mouse_queue[HOST_MOUSE_QUEUE_SIZE];
+static uint8_t mouse_queue_len = 0;
+static uint16_t mouse_sent = 0;
+
+static void mouse_queue_add(report_mouse_t *report);
+static void mouse_flush(void);
+#endif
+
 
 void host_set_driver(host_driver_t *d)
 {
     driver = d;
+#ifdef MOUSE_ENABLE
+    mouse_queue_len = 0;
+#endif
 }
 
 host_driver_t *host_get_driver(void)
@@ -51,9 +93,10 @@ uint8_t host_keyboard_leds(void)
 void host_keyboard_send(report_keyboard_t *report)
 {
     if (!driver) return;
+    latency_mark(LATENCY_HOST);
     (*driver->send_keyboard)(report);
 
-    if (debug_keyboard) {
+    if (log_active(HOST, LOG_LEVEL_DEBUG)) {
         dprint("keyboard_report: ");
         for (uint8_t i = 0; i < REPORT_SIZE; i++) {
             dprintf("%02X ", report->raw[i]);
@@ -65,7 +108,29 @@ void host_keyboard_send(report_keyboard_t *report)
 void host_mouse_send(report_mouse_t *report)
 {
     if (!driver) return;
+#ifdef MOUSE_ENABLE
+    mouse_queue_add(report);
+    mouse_flush();
+#else
     (*driver->send_mouse)(report);
+#endif
+}
+
+void host_mouse_task(void)
+{
+#ifdef MOUSE_ENABLE
+    if (!driver) return;
+    mouse_flush();
+#endif
+}
+
+uint16_t host_mouse_sent_count(void)
+{
+#ifdef MOUSE_ENABLE
+    return mouse_sent;
+#else
+    return 0;
+#endif
 }
 
 void host_system_send(uint16_t report)
@@ -95,3 +160,80 @@ uint16_t host_last_consumer_report(void)
 {
     return last_consumer_report;
 }
+
+
+#ifdef MOUSE_ENABLE
+static int16_t add_sat(int16_t a, int16_t b)
+{
+    int32_t r = (int32_t)a + b;
+    if (r > INT16_MAX) return INT16_MAX;
+    if (r < INT16_MIN) return INT16_MIN;
+    return r;
+}
+
+static int8_t take(int16_t *a)
+{
+    int8_t r = (*a > 127 ? 127 : (*a < -127 ? -127 : *a));
+    *a -= r;
+    return r;
+}
+
+static void mouse_queue_pop(void)
+{
+    mouse_queue_len--;
+    memmove(&mouse_queue[0], &mouse_queue[1], mouse_queue_len * sizeof(mouse_entry_t));
+}
+
+/* free oldest slot, called from main loop so never waits for endpoint */
+static void mouse_queue_make_room(void)
+{
+    if (mouse_queue_len < HOST_MOUSE_QUEUE_SIZE)
+        return;
+
+    if (mouse_queue[0].sent) {
+        /* only motion is left, next entry has other buttons so drop it */
+        log_debug(HOST, "mouse: queue full, motion dropped\n");
+    } else {
+        log_warn(HOST, "mouse: endpoint stalled, report dropped\n");
+    }
+    mouse_queue_pop();
+}
+
+static void mouse_queue_add(report_mouse_t *report)
+{
+    mouse_entry_t *e = (mouse_queue_len ? &mouse_queue[mouse_queue_len - 1] : NULL);
+    if (!e || e->buttons != report->buttons) {
+        mouse_queue_make_room();
+        e = &mouse_queue[mouse_queue_len++];
+        *e = (mouse_entry_t){ .buttons = report->buttons };
+    }
+    e->x = add_sat(e->x, report->x);
+    e->y = add_sat(e->y, report->y);
+    e->v = add_sat(e->v, report->v);
+    e->h = add_sat(e->h, report->h);
+}
+
+static void mouse_flush(void)
+{
+    while (mouse_queue_len) {
+        mouse_entry_t *e = &mouse_queue[0];
+        mouse_entry_t rest = *e;
+        report_mouse_t r = {
+            .buttons = e->buttons,
+            .x = take(&rest.x),
+            .y = take(&rest.y),
+            .v = take(&rest.v),
+            .h = take(&rest.h),
+        };
+        if (!(*driver->send_mouse)(&r))
+            return;
+        mouse_sent++;
+
+        *e = rest;
+        e->sent = true;
+        if (!e->x && !e->y && !e->v && !e->h) {
+            mouse_queue_pop();
+        }
+    }
+}
+#endif
@@ -29,7 +29,10 @@ extern "C" {
 #endif
 
 #ifdef NKRO_ENABLE
+/* requested by host, driver may change it from ISR at any time */
 extern bool keyboard_nkro;
+/* layout of report passed to host_keyboard_send(), drivers select endpoint by this */
+extern bool keyboard_report_nkro;
 #endif
 
 
@@ -41,6 +44,10 @@ host_driver_t *host_get_driver(void);
 uint8_t host_keyboard_leds(void);
 void host_keyboard_send(report_keyboard_t *report);
 void host_mouse_send(report_mouse_t *report);
+/* send mouse reports held while endpoint was busy */
+void host_mouse_task(void);
+/* number of mouse reports taken by driver, wraps around */
+uint16_t host_mouse_sent_count(void);
 void host_system_send(uint16_t data);
 void host_consumer_send(uint16_t data);
 
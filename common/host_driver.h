@@ -19,13 +19,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define HOST_DRIVER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "report.h"
 
 
 typedef struct {
     uint8_t (*keyboard_leds)(void);
     void (*send_keyboard)(report_keyboard_t *);
-    void (*send_mouse)(report_mouse_t *);
+    /* return false when endpoint is busy, host layer keeps report and retries */
+    bool (*send_mouse)(report_mouse_t *);
     void (*send_system)(uint16_t);
     void (*send_consumer)(uint16_t);
 } host_driver_t;
@@ -25,6 +25,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "timer.h"
 #include "print.h"
 #include "debug.h"
+#include "latency.h"
+#include "scan_stats.h"
+#include "swtimer.h"
+#include "adaptive_scan.h"
 #include "command.h"
 #include "util.h"
 #include "sendchar.h"
@@ -85,12 +89,13 @@ void keyboard_task(void)
     matrix_row_t matrix_row = 0;
     matrix_row_t matrix_change = 0;
 
+    scan_stats_loop();
     matrix_scan();
     for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
         matrix_row = matrix_get_row(r);
         matrix_change = matrix_row ^ matrix_prev[r];
         if (matrix_change) {
-            if (debug_matrix) matrix_print();
+            if (log_active(MATRIX, LOG_LEVEL_DEBUG)) matrix_print();
 #ifdef MATRIX_HAS_GHOST
             if (has_ghost_in_row(r)) {
                 matrix_prev[r] = matrix_row;
@@ -99,6 +104,9 @@ void keyboard_task(void)
 #endif
             for (uint8_t c = 0; c < MATRIX_COLS; c++) {
                 if (matrix_change & ((matrix_row_t)1<<c)) {
+                    latency_start();
+                    scan_stats_event();
+                    adaptive_scan_activity();
                     action_exec((keyevent_t){
                         .key = (key_t){ .row = r, .col = c },
                         .pressed = (matrix_row & ((matrix_row_t)1<<c)),
@@ -117,9 +125,12 @@ void keyboard_task(void)
 
 MATRIX_LOOP_END:
 
-#ifdef MOUSEKEY_ENABLE
-    // mousekey repeat & acceleration
-    mousekey_task();
+    // deferred jobs: mousekey repeat & acceleration, oneshot timeout
+    swtimer_task();
+
+#ifdef MOUSE_ENABLE
+    // mouse reports held while endpoint was busy
+    host_mouse_task();
 #endif
 
 #ifdef PS2_MOUSE_ENABLE
@@ -135,6 +146,6 @@ MATRIX_LOOP_END:
 
 void keyboard_set_leds(uint8_t leds)
 {
-    if (debug_keyboard) { debug("keyboard_set_led: "); debug_hex8(leds); debug("\n"); }
+    log_debug(HOST, "keyboard_set_led: %02X\n", leds);
     led_set(leds);
 }
@@ -0,0 +1,95 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "timer.h"
+#include "print.h"
+#include "latency.h"
+
+
+static uint16_t histogram[LATENCY_STAGES][LATENCY_BUCKETS];
+static uint16_t latency_max[LATENCY_STAGES];
+static uint32_t start_us;
+/* stages not recorded yet since latency_start */
+static uint8_t pending = 0;
+
+
+void latency_start(void)
+{
+    uint32_t t = timer_read_us();
+    uint8_t sreg = SREG;
+    cli();
+    start_us = t;
+    pending = (1<<LATENCY_STAGES) - 1;
+    SREG = sreg;
+}
+
+/* can be called from interrupt */
+void latency_mark(uint8_t stage)
+{
+    uint32_t t = timer_read_us();
+    uint8_t sreg = SREG;
+    cli();
+    // stage is recorded only after all stages before it
+    if ((pending & (1<<stage)) && !(pending & ((1<<stage) - 1))) {
+        pending &= ~(1<<stage);
+
+        uint32_t us = t - start_us;
+        if (us > UINT16_MAX) us = UINT16_MAX;
+        if (us > latency_max[stage]) latency_max[stage] = us;
+
+        uint8_t b = 0;
+        for (uint16_t v = us >> 7; v && b < LATENCY_BUCKETS - 1; v >>= 1) b++;
+        if (histogram[stage][b] != UINT16_MAX) histogram[stage][b]++;
+    }
+    SREG = sreg;
+}
+
+void latency_print(void)
+{
+    static const char *const stage_name[LATENCY_STAGES] = { "action", "host", "usb" };
+
+    print("\n----- Latency(us) -----\n");
+    print("<128 <256 <512 <1024 <2048 <4096 <8192 more max\n");
+    for (uint8_t s = 0; s < LATENCY_STAGES; s++) {
+        uint16_t h[LATENCY_BUCKETS];
+        uint16_t max;
+        uint8_t sreg = SREG;
+        cli();
+        for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) h[b] = histogram[s][b];
+        max = latency_max[s];
+        SREG = sreg;
+
+        print_S(stage_name[s]); print(":");
+        for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+            print(" "); print_dec(h[b]);
+        }
+        print(" "); print_dec(max); print("\n");
+    }
+}
+
+void latency_clear(void)
+{
+    uint8_t sreg = SREG;
+    cli();
+    for (uint8_t s = 0; s < LATENCY_STAGES; s++) {
+        for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) histogram[s][b] = 0;
+        latency_max[s] = 0;
+    }
+    pending = 0;
+    SREG = sreg;
+}
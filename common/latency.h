@@ -0,0 +1,56 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+
+/*
+ * End-to-end latency histogram
+ *
+ * latency_start() stamps a key event detected in matrix, latency_mark() records
+ * time from the stamp to the first following pass of each stage:
+ *     ACTION:  action_exec entered
+ *     HOST:    report handed to host_keyboard_send
+ *     USB:     report written to endpoint bank
+ * Histogram bucket n counts latency under 128<<n us, last bucket is the rest.
+ */
+#define LATENCY_ACTION  0
+#define LATENCY_HOST    1
+#define LATENCY_USB     2
+#define LATENCY_STAGES  3
+
+#define LATENCY_BUCKETS 8
+
+
+#ifdef LATENCY_ENABLE
+
+void latency_start(void);
+void latency_mark(uint8_t stage);
+void latency_print(void);
+void latency_clear(void);
+
+#else
+
+#define latency_start()
+#define latency_mark(stage)
+#define latency_print()
+#define latency_clear()
+
+#endif
+
+#endif
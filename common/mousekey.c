@@ -16,10 +16,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <avr/pgmspace.h>
 #include <util/delay.h>
 #include "keycode.h"
 #include "host.h"
 #include "timer.h"
+#include "swtimer.h"
 #include "print.h"
 #include "debug.h"
 #include "mousekey.h"
@@ -30,6 +33,33 @@ static report_mouse_t mouse_report = {};
 static uint8_t mousekey_repeat =  0;
 static uint8_t mousekey_accel = 0;
 
+/* direction of keys held: -1, 0 or 1 */
+static int8_t move_x = 0;
+static int8_t move_y = 0;
+static int8_t move_v = 0;
+static int8_t move_h = 0;
+
+/* sub-pixel remainder carried to next event in 1/256 */
+static int16_t frac_x = 0;
+static int16_t frac_y = 0;
+static int16_t frac_v = 0;
+static int16_t frac_h = 0;
+
+#ifdef MOUSEKEY_KINETIC
+/* velocity in 1/256 pixel(or notch) per second */
+static int32_t vel_x = 0;
+static int32_t vel_y = 0;
+static int32_t vel_v = 0;
+static int32_t vel_h = 0;
+
+/* reports made and taken by USB driver in last second while debug is on */
+static uint16_t kinetic_reports = 0;
+static uint16_t kinetic_sent = 0;
+static uint16_t kinetic_last = 0;
+
+static void mousekey_kinetic_timer(void);
+#endif
+
 static void mousekey_debug(void);
 
 
@@ -37,7 +67,10 @@ static void mousekey_debug(void);
  * Mouse keys  acceleration algorithm
  *  http://en.wikipedia.org/wiki/Mouse_keys
  *
- *  speed = delta * max_speed * (repeat / time_to_max)**((1000+curve)/1000)
+ *  speed = delta * max_speed * curve(repeat / time_to_max)
+ *
+ * Speed is calculated in 1/256 pixel and fraction is accumulated, so that
+ * slow moves at start of ramp are smooth and no floating point is used.
  */
 /* milliseconds between the initial key press and first repeated motion event (0-2550) */
 uint8_t mk_delay = MOUSEKEY_DELAY/10;
@@ -47,95 +80,205 @@ uint8_t mk_interval = MOUSEKEY_INTERVAL;
 uint8_t mk_max_speed = MOUSEKEY_MAX_SPEED;
 /* number of events (count) accelerating to steady speed (0-255) */
 uint8_t mk_time_to_max = MOUSEKEY_TIME_TO_MAX;
-/* ramp used to reach maximum pointer speed (NOT SUPPORTED) */
-//int8_t mk_curve = 0;
+/* ramp used to reach maximum pointer speed (0-3: see mk_curves) */
+uint8_t mk_curve = MOUSEKEY_CURVE;
 /* wheel params */
 uint8_t mk_wheel_max_speed = MOUSEKEY_WHEEL_MAX_SPEED;
 uint8_t mk_wheel_time_to_max = MOUSEKEY_WHEEL_TIME_TO_MAX;
 
 
-static uint16_t last_timer = 0;
+static bool mousekey_moving(void)
+{
+    return move_x || move_y || move_v || move_h;
+}
 
+#ifdef MOUSEKEY_KINETIC
+/*
+ * Kinetic mode
+ *
+ * Keys only give direction, velocity is integrated every
+ * MOUSEKEY_KINETIC_INTERVAL ms by timer: accelerates while key is held,
+ * decays by friction after release and moves pointer in small steps.
+ */
+/* change of velocity in an interval */
+#define KINETIC_DV(v)       ((int32_t)(v) * 256 * MOUSEKEY_KINETIC_INTERVAL / 1000)
+#define KINETIC_ACCEL       KINETIC_DV(MOUSEKEY_KINETIC_ACCEL)
+#define KINETIC_FRICTION    KINETIC_DV(MOUSEKEY_KINETIC_FRICTION)
+#define KINETIC_MAX         ((int32_t)MOUSEKEY_KINETIC_MAX_SPEED * 256)
+#define KINETIC_WH_ACCEL    KINETIC_DV(MOUSEKEY_KINETIC_WHEEL_ACCEL)
+#define KINETIC_WH_FRICTION KINETIC_DV(MOUSEKEY_KINETIC_WHEEL_FRICTION)
+#define KINETIC_WH_MAX      ((int32_t)MOUSEKEY_KINETIC_WHEEL_MAX_SPEED * 256)
 
-static uint8_t move_unit(void)
+static int8_t kinetic_step(int8_t dir, int32_t *vel, int16_t *frac,
+                           int32_t accel, int32_t friction, int32_t max)
 {
-    uint16_t unit;
-    if (mousekey_accel & (1<<0)) {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed)/4;
-    } else if (mousekey_accel & (1<<1)) {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed)/2;
-    } else if (mousekey_accel & (1<<2)) {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed);
-    } else if (mousekey_repeat == 0) {
-        unit = MOUSEKEY_MOVE_DELTA;
-    } else if (mousekey_repeat >= mk_time_to_max) {
-        unit = MOUSEKEY_MOVE_DELTA * mk_max_speed;
+    if (dir) {
+        *vel += (dir > 0 ? accel : -accel);
+        if (*vel > max) *vel = max;
+        if (*vel < -max) *vel = -max;
+    } else if (*vel > friction) {
+        *vel -= friction;
+    } else if (*vel < -friction) {
+        *vel += friction;
     } else {
-        unit = (MOUSEKEY_MOVE_DELTA * mk_max_speed * mousekey_repeat) / mk_time_to_max;
+        *vel = 0;
+        *frac = 0;
+        return 0;
+    }
+
+    /* distance in 1/256 during an interval */
+    int32_t total = *frac + *vel * MOUSEKEY_KINETIC_INTERVAL / 1000;
+    int16_t count = total / 256;
+    if (count > 127) count = 127;
+    if (count < -127) count = -127;
+    *frac = total - (int32_t)count * 256;
+    return count;
+}
+
+static bool kinetic_active(void)
+{
+    return move_x || move_y || move_v || move_h ||
+           vel_x || vel_y || vel_v || vel_h;
+}
+
+static void mousekey_kinetic_timer(void)
+{
+    int32_t max = KINETIC_MAX;
+    /* accel keys limit speed */
+    if (mousekey_accel & (1<<0)) max /= 4;
+    else if (mousekey_accel & (1<<1)) max /= 2;
+    /* diagonal move: 1/sqrt(2) = 181/256 */
+    if (move_x && move_y) {
+        max = (max * 181) >> 8;
     }
-    return (unit > MOUSEKEY_MOVE_MAX ? MOUSEKEY_MOVE_MAX : (unit == 0 ? 1 : unit));
+    mouse_report.x = kinetic_step(move_x, &vel_x, &frac_x, KINETIC_ACCEL, KINETIC_FRICTION, max);
+    mouse_report.y = kinetic_step(move_y, &vel_y, &frac_y, KINETIC_ACCEL, KINETIC_FRICTION, max);
+    mouse_report.v = kinetic_step(move_v, &vel_v, &frac_v, KINETIC_WH_ACCEL, KINETIC_WH_FRICTION, KINETIC_WH_MAX);
+    mouse_report.h = kinetic_step(move_h, &vel_h, &frac_h, KINETIC_WH_ACCEL, KINETIC_WH_FRICTION, KINETIC_WH_MAX);
+
+    if (mouse_report.x || mouse_report.y || mouse_report.v || mouse_report.h) {
+        host_mouse_send(&mouse_report);
+        mouse_report.x = mouse_report.y = mouse_report.v = mouse_report.h = 0;
+        kinetic_reports++;
+    }
+
+    if (log_active(MOUSE, LOG_LEVEL_DEBUG) && timer_elapsed(kinetic_last) >= 1000) {
+        uint16_t sent = host_mouse_sent_count();
+        if (kinetic_reports) {
+            log_debug(MOUSE, "mousekey: %u reports/s, %u sent/s\n", kinetic_reports, sent - kinetic_sent);
+        }
+        kinetic_reports = 0;
+        kinetic_sent = sent;
+        kinetic_last = timer_read();
+    }
+
+    if (kinetic_active())
+        swtimer_set(mousekey_kinetic_timer, MOUSEKEY_KINETIC_INTERVAL);
+}
+
+/* one pixel(or notch) at once on key press, timer takes over from then */
+static void mousekey_move(void)
+{
+    if (move_x && !vel_x) { mouse_report.x = move_x; frac_x = 0; }
+    if (move_y && !vel_y) { mouse_report.y = move_y; frac_y = 0; }
+    if (move_v && !vel_v) { mouse_report.v = move_v; frac_v = 0; }
+    if (move_h && !vel_h) { mouse_report.h = move_h; frac_h = 0; }
 }
+#else
+/* ramp curves: x**exp at x = 0, 1/16, ... 1 in 1/256 */
+static const uint16_t PROGMEM mk_curves[MOUSEKEY_CURVE_COUNT][17] = {
+    // exp 1: linear
+    { 0, 16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240, 256 },
+    // exp 1.5
+    { 0, 4, 11, 21, 32, 45, 59, 74, 91, 108, 126, 146, 166, 187, 210, 232, 256 },
+    // exp 2: slow start
+    { 0, 1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121, 144, 169, 196, 225, 256 },
+    // exp 0.5: fast start
+    { 0, 64, 91, 111, 128, 143, 157, 169, 181, 192, 202, 212, 222, 231, 239, 248, 256 },
+};
 
-static uint8_t wheel_unit(void)
+/* speed in 1/256 pixel per event */
+static uint16_t unit(uint8_t delta, uint8_t max_speed, uint8_t time_to_max, uint8_t max)
 {
-    uint16_t unit;
+    uint32_t u;
     if (mousekey_accel & (1<<0)) {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed)/4;
+        u = ((uint32_t)delta * max_speed << 8)/4;
     } else if (mousekey_accel & (1<<1)) {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed)/2;
+        u = ((uint32_t)delta * max_speed << 8)/2;
     } else if (mousekey_accel & (1<<2)) {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed);
+        u = ((uint32_t)delta * max_speed << 8);
     } else if (mousekey_repeat == 0) {
-        unit = MOUSEKEY_WHEEL_DELTA;
-    } else if (mousekey_repeat >= mk_wheel_time_to_max) {
-        unit = MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed;
+        u = (uint16_t)delta << 8;
     } else {
-        unit = (MOUSEKEY_WHEEL_DELTA * mk_wheel_max_speed * mousekey_repeat) / mk_wheel_time_to_max;
+        uint16_t x = (mousekey_repeat >= time_to_max ? 256 : ((uint16_t)mousekey_repeat << 8) / time_to_max);
+        const uint16_t *curve = mk_curves[mk_curve < MOUSEKEY_CURVE_COUNT ? mk_curve : 0];
+        uint8_t i = x >> 4;
+        uint16_t y = pgm_read_word(&curve[i]);
+        if (i < 16) {
+            y += ((pgm_read_word(&curve[i + 1]) - y) * (x & 0x0F)) >> 4;
+        }
+        u = ((uint32_t)delta * max_speed * y);
     }
-    return (unit > MOUSEKEY_WHEEL_MAX ? MOUSEKEY_WHEEL_MAX : (unit == 0 ? 1 : unit));
+    if (u > ((uint16_t)max << 8)) return (uint16_t)max << 8;
+    if (u < MOUSEKEY_UNIT_MIN) return MOUSEKEY_UNIT_MIN;
+    return u;
 }
 
-void mousekey_task(void)
+/* whole pixels out of speed and remainder of previous event */
+static int8_t step(int8_t dir, uint16_t u, int16_t *frac)
 {
-    if (timer_elapsed(last_timer) < (mousekey_repeat ? mk_interval : mk_delay*10))
-        return;
+    if (!dir) {
+        *frac = 0;
+        return 0;
+    }
+    int32_t total = *frac + (dir > 0 ? (int32_t)u : -(int32_t)u);
+    int16_t count = total / 256;
+    if (count > 127) count = 127;
+    if (count < -127) count = -127;
+    *frac = total - (int32_t)count * 256;
+    return count;
+}
 
-    if (mouse_report.x == 0 && mouse_report.y == 0 && mouse_report.v == 0 && mouse_report.h == 0)
+/* calculate report from keys held */
+static void mousekey_move(void)
+{
+    uint16_t u = unit(MOUSEKEY_MOVE_DELTA, mk_max_speed, mk_time_to_max, MOUSEKEY_MOVE_MAX);
+    /* diagonal move: 1/sqrt(2) = 181/256 */
+    if (move_x && move_y) {
+        u = ((uint32_t)u * 181) >> 8;
+    }
+    mouse_report.x = step(move_x, u, &frac_x);
+    mouse_report.y = step(move_y, u, &frac_y);
+
+    u = unit(MOUSEKEY_WHEEL_DELTA, mk_wheel_max_speed, mk_wheel_time_to_max, MOUSEKEY_WHEEL_MAX);
+    mouse_report.v = step(move_v, u, &frac_v);
+    mouse_report.h = step(move_h, u, &frac_h);
+}
+
+/* repeat and acceleration, timer is set by mousekey_send while moving */
+static void mousekey_repeat_timer(void)
+{
+    if (!mousekey_moving())
         return;
 
     if (mousekey_repeat != UINT8_MAX)
         mousekey_repeat++;
 
-
-    if (mouse_report.x > 0) mouse_report.x = move_unit();
-    if (mouse_report.x < 0) mouse_report.x = move_unit() * -1;
-    if (mouse_report.y > 0) mouse_report.y = move_unit();
-    if (mouse_report.y < 0) mouse_report.y = move_unit() * -1;
-
-    /* diagonal move [1/sqrt(2) = 0.7] */
-    if (mouse_report.x && mouse_report.y) {
-        mouse_report.x *= 0.7;
-        mouse_report.y *= 0.7;
-    }
-
-    if (mouse_report.v > 0) mouse_report.v = wheel_unit();
-    if (mouse_report.v < 0) mouse_report.v = wheel_unit() * -1;
-    if (mouse_report.h > 0) mouse_report.h = wheel_unit();
-    if (mouse_report.h < 0) mouse_report.h = wheel_unit() * -1;
-
+    mousekey_move();
     mousekey_send();
 }
+#endif
 
 void mousekey_on(uint8_t code)
 {
-    if      (code == KC_MS_UP)       mouse_report.y = move_unit() * -1;
-    else if (code == KC_MS_DOWN)     mouse_report.y = move_unit();
-    else if (code == KC_MS_LEFT)     mouse_report.x = move_unit() * -1;
-    else if (code == KC_MS_RIGHT)    mouse_report.x = move_unit();
-    else if (code == KC_MS_WH_UP)    mouse_report.v = wheel_unit();
-    else if (code == KC_MS_WH_DOWN)  mouse_report.v = wheel_unit() * -1;
-    else if (code == KC_MS_WH_LEFT)  mouse_report.h = wheel_unit() * -1;
-    else if (code == KC_MS_WH_RIGHT) mouse_report.h = wheel_unit();
+    if      (code == KC_MS_UP)       move_y = -1;
+    else if (code == KC_MS_DOWN)     move_y = 1;
+    else if (code == KC_MS_LEFT)     move_x = -1;
+    else if (code == KC_MS_RIGHT)    move_x = 1;
+    else if (code == KC_MS_WH_UP)    move_v = 1;
+    else if (code == KC_MS_WH_DOWN)  move_v = -1;
+    else if (code == KC_MS_WH_LEFT)  move_h = -1;
+    else if (code == KC_MS_WH_RIGHT) move_h = 1;
     else if (code == KC_MS_BTN1)     mouse_report.buttons |= MOUSE_BTN1;
     else if (code == KC_MS_BTN2)     mouse_report.buttons |= MOUSE_BTN2;
     else if (code == KC_MS_BTN3)     mouse_report.buttons |= MOUSE_BTN3;
@@ -144,18 +287,21 @@ void mousekey_on(uint8_t code)
     else if (code == KC_MS_ACCEL0)   mousekey_accel |= (1<<0);
     else if (code == KC_MS_ACCEL1)   mousekey_accel |= (1<<1);
     else if (code == KC_MS_ACCEL2)   mousekey_accel |= (1<<2);
+
+    if (IS_MOUSEKEY_MOVE(code) || IS_MOUSEKEY_WHEEL(code))
+        mousekey_move();
 }
 
 void mousekey_off(uint8_t code)
 {
-    if      (code == KC_MS_UP       && mouse_report.y < 0) mouse_report.y = 0;
-    else if (code == KC_MS_DOWN     && mouse_report.y > 0) mouse_report.y = 0;
-    else if (code == KC_MS_LEFT     && mouse_report.x < 0) mouse_report.x = 0;
-    else if (code == KC_MS_RIGHT    && mouse_report.x > 0) mouse_report.x = 0;
-    else if (code == KC_MS_WH_UP    && mouse_report.v > 0) mouse_report.v = 0;
-    else if (code == KC_MS_WH_DOWN  && mouse_report.v < 0) mouse_report.v = 0;
-    else if (code == KC_MS_WH_LEFT  && mouse_report.h < 0) mouse_report.h = 0;
-    else if (code == KC_MS_WH_RIGHT && mouse_report.h > 0) mouse_report.h = 0;
+    if      (code == KC_MS_UP       && move_y < 0) move_y = mouse_report.y = 0;
+    else if (code == KC_MS_DOWN     && move_y > 0) move_y = mouse_report.y = 0;
+    else if (code == KC_MS_LEFT     && move_x < 0) move_x = mouse_report.x = 0;
+    else if (code == KC_MS_RIGHT    && move_x > 0) move_x = mouse_report.x = 0;
+    else if (code == KC_MS_WH_UP    && move_v > 0) move_v = mouse_report.v = 0;
+    else if (code == KC_MS_WH_DOWN  && move_v < 0) move_v = mouse_report.v = 0;
+    else if (code == KC_MS_WH_LEFT  && move_h < 0) move_h = mouse_report.h = 0;
+    else if (code == KC_MS_WH_RIGHT && move_h > 0) move_h = mouse_report.h = 0;
     else if (code == KC_MS_BTN1) mouse_report.buttons &= ~MOUSE_BTN1;
     else if (code == KC_MS_BTN2) mouse_report.buttons &= ~MOUSE_BTN2;
     else if (code == KC_MS_BTN3) mouse_report.buttons &= ~MOUSE_BTN3;
@@ -165,7 +311,7 @@ void mousekey_off(uint8_t code)
     else if (code == KC_MS_ACCEL1) mousekey_accel &= ~(1<<1);
     else if (code == KC_MS_ACCEL2) mousekey_accel &= ~(1<<2);
 
-    if (mouse_report.x == 0 && mouse_report.y == 0 && mouse_report.v == 0 && mouse_report.h == 0)
+    if (!mousekey_moving())
         mousekey_repeat = 0;
 }
 
@@ -173,7 +319,16 @@ void mousekey_send(void)
 {
     mousekey_debug();
     host_mouse_send(&mouse_report);
-    last_timer = timer_read();
+#ifdef MOUSEKEY_KINETIC
+    mouse_report.x = mouse_report.y = mouse_report.v = mouse_report.h = 0;
+    if (mousekey_moving())
+        swtimer_set(mousekey_kinetic_timer, MOUSEKEY_KINETIC_INTERVAL);
+#else
+    if (mousekey_moving())
+        swtimer_set(mousekey_repeat_timer, (mousekey_repeat ? mk_interval : mk_delay*10));
+    else
+        swtimer_cancel(mousekey_repeat_timer);
+#endif
 }
 
 void mousekey_clear(void)
@@ -181,11 +336,19 @@ void mousekey_clear(void)
     mouse_report = (report_mouse_t){};
     mousekey_repeat = 0;
     mousekey_accel = 0;
+    move_x = move_y = move_v = move_h = 0;
+    frac_x = frac_y = frac_v = frac_h = 0;
+#ifdef MOUSEKEY_KINETIC
+    vel_x = vel_y = vel_v = vel_h = 0;
+    swtimer_cancel(mousekey_kinetic_timer);
+#else
+    swtimer_cancel(mousekey_repeat_timer);
+#endif
 }
 
 static void mousekey_debug(void)
 {
-    if (!debug_mouse) return;
+    if (!log_active(MOUSE, LOG_LEVEL_DEBUG)) return;
     print("mousekey [btn|x y v h](rep/acl): [");
     phex(mouse_report.buttons); print("|");
     print_decs(mouse_report.x); print(" ");
@@ -50,17 +50,54 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MOUSEKEY_WHEEL_TIME_TO_MAX
 #define MOUSEKEY_WHEEL_TIME_TO_MAX 40
 #endif
+/* acceleration ramp: 0=linear 1=x**1.5 2=x**2 3=x**0.5 */
+#ifndef MOUSEKEY_CURVE
+#define MOUSEKEY_CURVE 0
+#endif
+#define MOUSEKEY_CURVE_COUNT    4
+/* slowest move in 1/256 pixel per event */
+#ifndef MOUSEKEY_UNIT_MIN
+#define MOUSEKEY_UNIT_MIN       64
+#endif
+
+/* kinetic mode: speed in pixel(wheel: notch) per second, accel and friction in per second^2 */
+#ifdef MOUSEKEY_KINETIC
+#ifndef MOUSEKEY_KINETIC_INTERVAL
+#define MOUSEKEY_KINETIC_INTERVAL           8
+#endif
+#ifndef MOUSEKEY_KINETIC_MAX_SPEED
+#define MOUSEKEY_KINETIC_MAX_SPEED          1200
+#endif
+#ifndef MOUSEKEY_KINETIC_ACCEL
+#define MOUSEKEY_KINETIC_ACCEL              3000
+#endif
+#ifndef MOUSEKEY_KINETIC_FRICTION
+#define MOUSEKEY_KINETIC_FRICTION           8000
+#endif
+#ifndef MOUSEKEY_KINETIC_WHEEL_MAX_SPEED
+#define MOUSEKEY_KINETIC_WHEEL_MAX_SPEED    20
+#endif
+#ifndef MOUSEKEY_KINETIC_WHEEL_ACCEL
+#define MOUSEKEY_KINETIC_WHEEL_ACCEL        40
+#endif
+#ifndef MOUSEKEY_KINETIC_WHEEL_FRICTION
+#define MOUSEKEY_KINETIC_WHEEL_FRICTION     200
+#endif
+#if MOUSEKEY_KINETIC_INTERVAL < 1 || MOUSEKEY_KINETIC_INTERVAL > 16
+#error "MOUSEKEY_KINETIC_INTERVAL must be 1-16"
+#endif
+#endif
 
 
-uint8_t mk_delay;
-uint8_t mk_interval;
-uint8_t mk_max_speed;
-uint8_t mk_time_to_max;
-uint8_t mk_wheel_max_speed;
-uint8_t mk_wheel_time_to_max;
+extern uint8_t mk_delay;
+extern uint8_t mk_interval;
+extern uint8_t mk_max_speed;
+extern uint8_t mk_time_to_max;
+extern uint8_t mk_curve;
+extern uint8_t mk_wheel_max_speed;
+extern uint8_t mk_wheel_time_to_max;
 
 
-void mousekey_task(void);
 void mousekey_on(uint8_t code);
 void mousekey_off(uint8_t code);
 void mousekey_clear(void);
@@ -25,6 +25,28 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define dprintf(fmt, ...)
 #define dmsg(s)
 
+/* error and warning are kept unless LOG_LEVEL is lowered, see debug_config.h */
+#ifndef NO_PRINT
+#include "print.h"
+#define log_enabled(sub, level)     (LOG_LEVEL_##sub >= (level) && (level) <= LOG_LEVEL_WARN)
+#define log_active(sub, level)      log_enabled(sub, level)
+#define log_print(sub, level, fmt, ...) do { \
+    if (log_active(sub, level)) __xprintf(PSTR(fmt), ##__VA_ARGS__); \
+} while (0)
+#else
+#define log_enabled(sub, level)     0
+#define log_active(sub, level)      0
+#define log_print(sub, level, fmt, ...)
+#endif
+#define log_error(sub, fmt, ...)    log_print(sub, LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define log_warn(sub, fmt, ...)     log_print(sub, LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define log_info(sub, fmt, ...)
+#define log_debug(sub, fmt, ...)
+#define dlog0(fmt)
+#define dlog1(fmt, a)
+#define dlog2(fmt, a, b)
+#define dlog3(fmt, a, b, c)
+
 #define debug(s)
 #define debugln(s)
 #define debug_S(s)
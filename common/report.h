@@ -74,15 +74,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /* key report size(NKRO or boot mode) */
 #if defined(PROTOCOL_PJRC) && defined(NKRO_ENABLE)
 #   include "usb.h"
-#   define REPORT_SIZE KBD2_SIZE
-#   define REPORT_KEYS (KBD2_SIZE - 2)
-#   define REPORT_BITS (KBD2_SIZE - 1)
+#   define REPORT_SIZE KBD2_REPORT_SIZE
+#   define REPORT_KEYS KBD_REPORT_KEYS
+#   define REPORT_BITS KBD2_REPORT_KEYS
 
 #elif defined(PROTOCOL_LUFA) && defined(NKRO_ENABLE)
 #   include "protocol/lufa/descriptor.h"
-#   define REPORT_SIZE NKRO_EPSIZE
-#   define REPORT_KEYS (NKRO_EPSIZE - 2)
-#   define REPORT_BITS (NKRO_EPSIZE - 1)
+#   define REPORT_SIZE NKRO_REPORT_SIZE
+#   define REPORT_KEYS (KEYBOARD_EPSIZE - 2)
+#   define REPORT_BITS NKRO_REPORT_BITS
 
 #else
 #   define REPORT_SIZE 8
@@ -101,11 +101,11 @@ extern "C" {
  * -----+--------+--------+--------+--------+--------+--------+--------+--------
  * desc |mods    |reserved|keys[0] |keys[1] |keys[2] |keys[3] |keys[4] |keys[5]
  *
- * It is exended to 16 bytes to retain 120keys+8mods when NKRO mode.
+ * It is exended to 33 bytes to retain all 256 keycodes+8mods when NKRO mode.
  *
- * byte |0       |1       |2       |3       |4       |5       |6       |7        ... |15
+ * byte |0       |1       |2       |3       |4       |5       |6       |7        ... |32
  * -----+--------+--------+--------+--------+--------+--------+--------+--------     +--------
- * desc |mods    |bits[0] |bits[1] |bits[2] |bits[3] |bits[4] |bits[5] |bits[6]  ... |bit[14]
+ * desc |mods    |bits[0] |bits[1] |bits[2] |bits[3] |bits[4] |bits[5] |bits[6]  ... |bit[31]
  *
  * mods retains state of 8 modifiers.
  *
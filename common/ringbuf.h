@@ -0,0 +1,97 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RINGBUF_H
+#define RINGBUF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Single producer single consumer byte ring buffer
+ *
+ * Lock-free between ISR and main loop: head is written only by producer and
+ * tail only by consumer, both are single byte so that their writes are atomic
+ * on AVR. Size must be power of 2 and 256 at most, capacity is size - 1.
+ *
+ * RINGBUF_DEFINE() defines static buffer and accessors named after it, which
+ * have address and mask of the buffer as constants:
+ *
+ *     RINGBUF_DEFINE(rbuf, 32);
+ *     rbuf_put(data);                     // producer
+ *     int16_t c = rbuf_get();             // consumer, -1 when empty
+ *
+ * rbuf.overflow counts bytes dropped when full and rbuf.high_water is maximum
+ * number of bytes ever stored, both are updated by producer and saturate at 255.
+ */
+typedef struct {
+    volatile uint8_t head;
+    volatile uint8_t tail;
+    volatile uint8_t overflow;
+    volatile uint8_t high_water;
+} ringbuf_t;
+
+#define RINGBUF_DEFINE(name, size) \
+    extern char name##_size_must_be_power_of_2[((size) & ((size) - 1)) || (size) > 256 ? -1 : 1]; \
+    static volatile uint8_t name##_data[size]; \
+    static ringbuf_t name; \
+    static inline bool name##_put(uint8_t data) { return __ringbuf_put(&name, name##_data, (size) - 1, data); } \
+    static inline int16_t name##_get(void) { return __ringbuf_get(&name, name##_data, (size) - 1); } \
+    static inline int16_t name##_peek(void) { return __ringbuf_peek(&name, name##_data); } \
+    static inline bool name##_has_data(void) { return name.head != name.tail; } \
+    static inline uint8_t name##_count(void) { return (name.head - name.tail) & ((size) - 1); } \
+    static inline uint8_t name##_free(void) { return (size) - 1 - name##_count(); } \
+    static inline void name##_clear(void) { name.tail = name.head; } \
+    /* rewind to start of buffer, only while producer is stopped */ \
+    static inline void name##_reset(void) { name.head = name.tail = 0; }
+
+
+/* producer */
+static inline bool __ringbuf_put(ringbuf_t *rb, volatile uint8_t *buf, uint8_t mask, uint8_t data)
+{
+    uint8_t head = rb->head;
+    uint8_t next = (head + 1) & mask;
+    uint8_t tail = rb->tail;
+    if (next == tail) {
+        if (rb->overflow != UINT8_MAX) rb->overflow++;
+        return false;
+    }
+    buf[head] = data;
+    rb->head = next;
+
+    uint8_t count = (next - tail) & mask;
+    if (count > rb->high_water) rb->high_water = count;
+    return true;
+}
+
+/* consumer */
+static inline int16_t __ringbuf_get(ringbuf_t *rb, volatile uint8_t *buf, uint8_t mask)
+{
+    uint8_t tail = rb->tail;
+    if (tail == rb->head) return -1;
+    uint8_t data = buf[tail];
+    rb->tail = (tail + 1) & mask;
+    return data;
+}
+
+static inline int16_t __ringbuf_peek(ringbuf_t *rb, volatile uint8_t *buf)
+{
+    uint8_t tail = rb->tail;
+    if (tail == rb->head) return -1;
+    return buf[tail];
+}
+
+#endif
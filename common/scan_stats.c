@@ -0,0 +1,61 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/interrupt.h>
+#include "timer.h"
+#include "print.h"
+#include "scan_stats.h"
+
+
+/* print stats every second */
+bool scan_stats_stream = false;
+
+static scan_stats_t count;
+static scan_stats_t last;
+static uint32_t loop_time = 0;
+static uint16_t second_time = 0;
+
+
+void scan_stats_loop(void)
+{
+    uint32_t now = timer_read_us();
+    if (count.loops) {
+        uint32_t t = now - loop_time;
+        if (t > UINT16_MAX) t = UINT16_MAX;
+        if (t > count.max_loop_us) count.max_loop_us = t;
+    }
+    loop_time = now;
+    count.loops++;
+
+    if (timer_elapsed(second_time) >= 1000) {
+        second_time = timer_read();
+        last = count;
+        count = (scan_stats_t){};
+        if (scan_stats_stream) scan_stats_print();
+    }
+}
+
+void scan_stats_event(void)
+{
+    count.events++;
+}
+
+void scan_stats_print(void)
+{
+    xprintf("loops/s: %lu events/s: %u max loop(us): %u\n",
+            last.loops, last.events, last.max_loop_us);
+}
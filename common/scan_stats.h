@@ -0,0 +1,52 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCAN_STATS_H
+#define SCAN_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Main loop statistics per second
+ *     loops:  keyboard_task calls, each of which scans the matrix once
+ *     events: key events processed
+ *     max:    longest time between keyboard_task calls in us
+ */
+typedef struct {
+    uint32_t loops;
+    uint16_t events;
+    uint16_t max_loop_us;
+} scan_stats_t;
+
+
+#ifdef SCAN_STATS_ENABLE
+
+extern bool scan_stats_stream;
+
+void scan_stats_loop(void);
+void scan_stats_event(void);
+void scan_stats_print(void);
+
+#else
+
+#define scan_stats_loop()
+#define scan_stats_event()
+#define scan_stats_print()
+
+#endif
+
+#endif
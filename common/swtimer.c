@@ -0,0 +1,85 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "debug.h"
+#include "swtimer.h"
+
+
+static struct {
+    swtimer_func_t func;
+    uint16_t deadline;
+} swtimers[SWTIMER_SLOTS];
+
+
+bool swtimer_set(swtimer_func_t func, uint16_t delay)
+{
+    uint8_t slot = SWTIMER_SLOTS;
+    for (uint8_t i = 0; i < SWTIMER_SLOTS; i++) {
+        if (swtimers[i].func == func) {
+            slot = i;
+            break;
+        }
+        if (!swtimers[i].func && slot == SWTIMER_SLOTS) {
+            slot = i;
+        }
+    }
+    if (slot == SWTIMER_SLOTS) {
+        dprint("swtimer: no slot\n");
+        return false;
+    }
+
+    swtimers[slot].deadline = timer_read() + delay;
+    swtimers[slot].func = func;
+    return true;
+}
+
+void swtimer_cancel(swtimer_func_t func)
+{
+    for (uint8_t i = 0; i < SWTIMER_SLOTS; i++) {
+        if (swtimers[i].func == func) {
+            swtimers[i].func = 0;
+        }
+    }
+}
+
+void swtimer_task(void)
+{
+    uint16_t now = timer_read();
+    for (uint8_t i = 0; i < SWTIMER_SLOTS; i++) {
+        swtimer_func_t func = swtimers[i].func;
+        if (func && (int16_t)(now - swtimers[i].deadline) >= 0) {
+            // clear before call, callback may set it again
+            swtimers[i].func = 0;
+            (*func)();
+        }
+    }
+}
+
+uint16_t swtimer_next_deadline(void)
+{
+    uint16_t now = timer_read();
+    uint16_t next = SWTIMER_NONE;
+    for (uint8_t i = 0; i < SWTIMER_SLOTS; i++) {
+        if (!swtimers[i].func) continue;
+
+        int16_t left = swtimers[i].deadline - now;
+        if (left <= 0) return 0;
+        if ((uint16_t)left < next) next = left;
+    }
+    return next;
+}
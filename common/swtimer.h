@@ -0,0 +1,54 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWTIMER_H
+#define SWTIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Software timer: one-shot callbacks in millisecond resolution
+ *
+ * Callbacks run from swtimer_task() in keyboard_task, not in interrupt.
+ * A function has at most one timer, setting it again restarts the timer and
+ * callback can set itself again to repeat. Delay must be less than 32768ms.
+ */
+#ifndef SWTIMER_SLOTS
+#define SWTIMER_SLOTS   4
+#endif
+
+#define SWTIMER_NONE    UINT16_MAX
+
+typedef void (*swtimer_func_t)(void);
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* return false when no slot is left */
+bool swtimer_set(swtimer_func_t func, uint16_t delay);
+void swtimer_cancel(swtimer_func_t func);
+void swtimer_task(void);
+/* ms until next deadline, 0 when due or SWTIMER_NONE when no timer is set */
+uint16_t swtimer_next_deadline(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -109,6 +109,38 @@ uint32_t timer_elapsed32(uint32_t last)
     return TIMER_DIFF_32(t, last);
 }
 
+/*
+ * Microsecond resolution from timer_count and TCNT0
+ *
+ * When compare match occurs in cli() section TCNT0 has wrapped already but
+ * timer_count is not incremented until the interrupt runs. OCF0A is checked
+ * for that and TCNT0 is read again after it so both values are consistent.
+ * Costs around 60 cycles at 16MHz, mostly for 32bit multiply by 1000.
+ * Value wraps in about 71 minutes, use timer_elapsed_us() for difference.
+ */
+uint32_t timer_read_us(void)
+{
+    uint32_t t;
+    uint8_t raw;
+
+    uint8_t sreg = SREG;
+    cli();
+    t = timer_count;
+    raw = TIMER_RAW;
+    if (TIFR0 & (1<<OCF0A)) {
+        t++;
+        raw = TIMER_RAW;
+    }
+    SREG = sreg;
+
+    return t * 1000 + TIMER_RAW_TO_US(raw);
+}
+
+uint32_t timer_elapsed_us(uint32_t last)
+{
+    return timer_read_us() - last;
+}
+
 // excecuted once per 1ms.(excess for just timer count?)
 ISR(TIMER0_COMPA_vect)
 {
@@ -39,6 +39,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #   error "Timer0 can't count 1ms at this clock freq. Use larger prescaler."
 #endif
 
+/* TIMER_RAW count in microseconds */
+#if (1000000UL % TIMER_RAW_FREQ == 0)
+#   define TIMER_RAW_TO_US(raw)     ((uint16_t)(raw) * (uint16_t)(1000000UL / TIMER_RAW_FREQ))
+#else
+#   define TIMER_RAW_TO_US(raw)     ((uint16_t)(((uint32_t)(raw) * (1000000UL * 256 / TIMER_RAW_FREQ)) >> 8))
+#endif
+
 #define TIMER_DIFF(a, b, max)   ((a) >= (b) ?  (a) - (b) : (max) - (b) + (a))
 #define TIMER_DIFF_8(a, b)      TIMER_DIFF(a, b, UINT8_MAX)
 #define TIMER_DIFF_16(a, b)     TIMER_DIFF(a, b, UINT16_MAX)
@@ -59,6 +66,8 @@ uint16_t timer_read(void);
 uint32_t timer_read32(void);
 uint16_t timer_elapsed(uint16_t last);
 uint32_t timer_elapsed32(uint32_t last);
+uint32_t timer_read_us(void);
+uint32_t timer_elapsed_us(uint32_t last);
 
 #ifdef __cplusplus
 }
@@ -51,6 +51,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define ADB_DATA_BIT    0
 //#define ADB_PSW_BIT     1       // optional
 
+#define BOOTMAGIC_SLOW_START
+
 /* key combination for command */
 #ifndef __ASSEMBLER__
 #include "adb.h"
@@ -111,7 +111,7 @@ uint8_t matrix_scan(void)
     key0 = codes>>8;
     key1 = codes&0xFF;
 
-    if (debug_matrix && codes) {
+    if (log_active(MATRIX, LOG_LEVEL_DEBUG) && codes) {
         print("adb_host_kbd_recv: "); phex16(codes); print("\n");
     }
 
@@ -168,7 +168,7 @@ uint16_t matrix_get_row(uint8_t row)
 
 void matrix_print(void)
 {
-    if (!debug_matrix) return;
+    if (!log_active(MATRIX, LOG_LEVEL_DEBUG)) return;
 #if (MATRIX_COLS <= 8)
     print("r/c 01234567\n");
 #else
@@ -44,6 +44,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
     keyboard_report->mods == (MOD_BIT(KC_LSHIFT) | MOD_BIT(KC_LALT) | MOD_BIT(KC_LCTL)) \
 )
 
+#define BOOTMAGIC_SLOW_START
+
 /* boot magic key */
 #define BOOTMAGIC_KEY_SALT                      KC_FN0
 #define BOOTMAGIC_KEY_CAPSLOCK_TO_CONTROL       KC_LCAP
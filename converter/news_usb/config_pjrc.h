@@ -41,6 +41,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
     keyboard_report->mods == (MOD_BIT(KC_LCTRL) | MOD_BIT(KC_RSHIFT)) \
 )
 
+#define BOOTMAGIC_SLOW_START
+
 
 /* Asynchronous USART
  * 8-data bit, non parity, 1-stop bit, no flow control
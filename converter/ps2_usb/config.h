@@ -43,6 +43,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //#define NO_SUSPEND_POWER_DOWN
 
 
+/* switch keyboard into Scan Code Set 3 with make/break keys, falls back to Set 2 */
+//#define PS2_USE_SET3
+
+
 /*
  * PS/2 Busywait
  */
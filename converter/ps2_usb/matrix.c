@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdint.h>
 #include <stdbool.h>
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 #include <util/delay.h>
 #include "action.h"
 #include "print.h"
@@ -33,6 +34,9 @@ static void matrix_clear(void);
 #ifdef MATRIX_HAS_GHOST
 static bool matrix_has_ghost_in_row(uint8_t row);
 #endif
+#ifdef PS2_USE_SET3
+static bool set3_config(void);
+#endif
 
 
 /*
@@ -70,6 +74,12 @@ static uint8_t matrix[MATRIX_ROWS];
 
 static bool is_modified = false;
 
+#ifdef PS2_USE_SET3
+static uint8_t scan_set = 2;
+#else
+#define scan_set 2
+#endif
+
 
 inline
 uint8_t matrix_rows(void)
@@ -91,6 +101,11 @@ void matrix_init(void)
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
 
+#ifdef PS2_USE_SET3
+    // keyboard still in power-on test is configured on its BAT code later
+    scan_set = (set3_config() ? 3 : 2);
+#endif
+
     return;
 }
 
@@ -157,228 +172,386 @@ void matrix_init(void)
  *               because it has no break code.
  *
  */
-uint8_t matrix_scan(void)
+/*
+ * Scan code decoder
+ *
+ * Every received byte is classified and looked up in transition table
+ * indexed by decoder state and byte class. Each entry has next state in low
+ * nibble and action in high nibble, so cost per byte is one table read.
+ */
+enum {
+    INIT,
+    F0,
+    E0,
+    E0_F0,
+    // Pause
+    E1,
+    E1_14,
+    E1_14_77,
+    E1_14_77_E1,
+    E1_14_77_E1_F0,
+    E1_14_77_E1_F0_14,
+    E1_14_77_E1_F0_14_F0,
+    // Control'd Pause
+    E0_7E,
+    E0_7E_E0,
+    E0_7E_E0_F0,
+    STATE_COUNT
+};
+
+/* byte classes: codes which have meaning in some state and the rest */
+enum {
+    C_KEY,      // 01-7F except below
+    C_00,
+    C_12,
+    C_14,
+    C_59,
+    C_77,
+    C_7E,
+    C_83,
+    C_84,
+    C_E0,
+    C_E1,
+    C_F0,
+    C_OTHER,    // 80-FF except above
+    CLASS_COUNT
+};
+
+enum {
+    A_NONE,
+    A_MAKE,
+    A_BREAK,
+    A_MAKE_E0,
+    A_BREAK_E0,
+    A_MAKE_F7,
+    A_BREAK_F7,
+    A_MAKE_PSCR,
+    A_BREAK_PSCR,
+    A_MAKE_PAUSE,
+    A_OVERRUN,
+    A_ERROR,
+};
+
+#define T(next, action) ((action)<<4 | (next))
+#define NEXT(t)         ((t) & 0x0F)
+#define ACTION(t)       ((t) >> 4)
+
+/* entries not listed are T(INIT, A_NONE) */
+static const uint8_t PROGMEM transition[STATE_COUNT][CLASS_COUNT] = {
+    [INIT] = {
+        [C_KEY]   = T(INIT, A_MAKE),
+        [C_00]    = T(INIT, A_OVERRUN),     // Overrun [3]p.25
+        [C_12]    = T(INIT, A_MAKE),
+        [C_14]    = T(INIT, A_MAKE),
+        [C_59]    = T(INIT, A_MAKE),
+        [C_77]    = T(INIT, A_MAKE),
+        [C_7E]    = T(INIT, A_MAKE),
+        [C_83]    = T(INIT, A_MAKE_F7),
+        [C_84]    = T(INIT, A_MAKE_PSCR),   // Alt'd PrintScreen
+        [C_E0]    = T(E0,   A_NONE),
+        [C_E1]    = T(E1,   A_NONE),
+        [C_F0]    = T(F0,   A_NONE),
+        [C_OTHER] = T(INIT, A_ERROR),
+    },
+    [F0] = {
+        [C_KEY]   = T(INIT, A_BREAK),
+        [C_00]    = T(INIT, A_BREAK),
+        [C_12]    = T(INIT, A_BREAK),
+        [C_14]    = T(INIT, A_BREAK),
+        [C_59]    = T(INIT, A_BREAK),
+        [C_77]    = T(INIT, A_BREAK),
+        [C_7E]    = T(INIT, A_BREAK),
+        [C_83]    = T(INIT, A_BREAK_F7),
+        [C_84]    = T(INIT, A_BREAK_PSCR),
+        [C_E0]    = T(INIT, A_ERROR),
+        [C_E1]    = T(INIT, A_ERROR),
+        [C_F0]    = T(F0,   A_ERROR),       // clear and continue
+        [C_OTHER] = T(INIT, A_ERROR),
+    },
+    [E0] = {
+        [C_KEY]   = T(INIT, A_MAKE_E0),
+        [C_00]    = T(INIT, A_MAKE_E0),
+        [C_12]    = T(INIT, A_NONE),        // to be ignored
+        [C_14]    = T(INIT, A_MAKE_E0),
+        [C_59]    = T(INIT, A_NONE),        // to be ignored
+        [C_77]    = T(INIT, A_MAKE_E0),
+        [C_7E]    = T(E0_7E, A_NONE),       // Control'd Pause
+        [C_83]    = T(INIT, A_ERROR),
+        [C_84]    = T(INIT, A_ERROR),
+        [C_E0]    = T(INIT, A_ERROR),
+        [C_E1]    = T(INIT, A_ERROR),
+        [C_F0]    = T(E0_F0, A_NONE),
+        [C_OTHER] = T(INIT, A_ERROR),
+    },
+    [E0_F0] = {
+        [C_KEY]   = T(INIT, A_BREAK_E0),
+        [C_00]    = T(INIT, A_BREAK_E0),
+        [C_12]    = T(INIT, A_NONE),        // to be ignored
+        [C_14]    = T(INIT, A_BREAK_E0),
+        [C_59]    = T(INIT, A_NONE),        // to be ignored
+        [C_77]    = T(INIT, A_BREAK_E0),
+        [C_7E]    = T(INIT, A_BREAK_E0),
+        [C_83]    = T(INIT, A_ERROR),
+        [C_84]    = T(INIT, A_ERROR),
+        [C_E0]    = T(INIT, A_ERROR),
+        [C_E1]    = T(INIT, A_ERROR),
+        [C_F0]    = T(INIT, A_ERROR),
+        [C_OTHER] = T(INIT, A_ERROR),
+    },
+    // Pause: E1 14 77 E1 F0 14 F0 77
+    [E1]                    = { [C_14] = T(E1_14, A_NONE) },
+    [E1_14]                 = { [C_77] = T(E1_14_77, A_NONE) },
+    [E1_14_77]              = { [C_E1] = T(E1_14_77_E1, A_NONE) },
+    [E1_14_77_E1]           = { [C_F0] = T(E1_14_77_E1_F0, A_NONE) },
+    [E1_14_77_E1_F0]        = { [C_14] = T(E1_14_77_E1_F0_14, A_NONE) },
+    [E1_14_77_E1_F0_14]     = { [C_F0] = T(E1_14_77_E1_F0_14_F0, A_NONE) },
+    [E1_14_77_E1_F0_14_F0]  = { [C_77] = T(INIT, A_MAKE_PAUSE) },
+    // Control'd Pause: E0 7E E0 F0 7E
+    [E0_7E]                 = { [C_E0] = T(E0_7E_E0, A_NONE) },
+    [E0_7E_E0]              = { [C_F0] = T(E0_7E_E0_F0, A_NONE) },
+    [E0_7E_E0_F0]           = { [C_7E] = T(INIT, A_MAKE_PAUSE) },
+};
+
+static uint8_t code_class(uint8_t code)
+{
+    switch (code) {
+        case 0x00: return C_00;
+        case 0x12: return C_12;
+        case 0x14: return C_14;
+        case 0x59: return C_59;
+        case 0x77: return C_77;
+        case 0x7E: return C_7E;
+        case 0x83: return C_83;
+        case 0x84: return C_84;
+        case 0xE0: return C_E0;
+        case 0xE1: return C_E1;
+        case 0xF0: return C_F0;
+        default:   return (code < 0x80 ? C_KEY : C_OTHER);
+    }
+}
+
+static uint8_t state = INIT;
+
+static void set2_decode(uint8_t code)
+{
+    uint8_t t = pgm_read_byte(&transition[state][code_class(code)]);
+    switch (ACTION(t)) {
+        case A_MAKE:        matrix_make(code);              break;
+        case A_BREAK:       matrix_break(code);             break;
+        case A_MAKE_E0:     matrix_make(code|0x80);         break;
+        case A_BREAK_E0:    matrix_break(code|0x80);        break;
+        case A_MAKE_F7:     matrix_make(F7);                break;
+        case A_BREAK_F7:    matrix_break(F7);               break;
+        case A_MAKE_PSCR:   matrix_make(PRINT_SCREEN);      break;
+        case A_BREAK_PSCR:  matrix_break(PRINT_SCREEN);     break;
+        case A_MAKE_PAUSE:  matrix_make(PAUSE);             break;
+        case A_OVERRUN:
+            matrix_clear();
+            clear_keyboard();
+            print("Overrun\n");
+            break;
+        case A_ERROR:
+            matrix_clear();
+            clear_keyboard();
+            xprintf("unexpected scan code at %u: %02X\n", state, code);
+            break;
+    }
+    state = NEXT(t);
+}
+
+
+#ifdef PS2_USE_SET3
+/*
+ * PS/2 Scan Code Set 3
+ *
+ * With all keys configured as make/break(F8) every key sends its one byte
+ * code on press and F0 and the code on release, without typematic repeat.
+ * Codes are translated into matrix positions of Set 2 above so that keymaps
+ * work in both sets. 0 means not supported.
+ */
+static const uint8_t PROGMEM set3_to_set2[0x90] = {
+    [0x07] = 0x05,  // F1
+    [0x08] = 0x76,  // Esc
+    [0x0D] = 0x0D,  // Tab
+    [0x0E] = 0x0E,  // `
+    [0x0F] = 0x06,  // F2
+    [0x11] = 0x14,  // LCtrl
+    [0x12] = 0x12,  // LShift
+    [0x13] = 0x61,  // ISO <>
+    [0x14] = 0x58,  // CapsLock
+    [0x15] = 0x15,  // Q
+    [0x16] = 0x16,  // 1
+    [0x17] = 0x04,  // F3
+    [0x19] = 0x11,  // LAlt
+    [0x1A] = 0x1A,  // Z
+    [0x1B] = 0x1B,  // S
+    [0x1C] = 0x1C,  // A
+    [0x1D] = 0x1D,  // W
+    [0x1E] = 0x1E,  // 2
+    [0x1F] = 0x0C,  // F4
+    [0x21] = 0x21,  // C
+    [0x22] = 0x22,  // X
+    [0x23] = 0x23,  // D
+    [0x24] = 0x24,  // E
+    [0x25] = 0x25,  // 4
+    [0x26] = 0x26,  // 3
+    [0x27] = 0x03,  // F5
+    [0x29] = 0x29,  // Space
+    [0x2A] = 0x2A,  // V
+    [0x2B] = 0x2B,  // F
+    [0x2C] = 0x2C,  // T
+    [0x2D] = 0x2D,  // R
+    [0x2E] = 0x2E,  // 5
+    [0x2F] = 0x0B,  // F6
+    [0x31] = 0x31,  // N
+    [0x32] = 0x32,  // B
+    [0x33] = 0x33,  // H
+    [0x34] = 0x34,  // G
+    [0x35] = 0x35,  // Y
+    [0x36] = 0x36,  // 6
+    [0x37] = F7,    // F7
+    [0x39] = 0x91,  // RAlt
+    [0x3A] = 0x3A,  // M
+    [0x3B] = 0x3B,  // J
+    [0x3C] = 0x3C,  // U
+    [0x3D] = 0x3D,  // 7
+    [0x3E] = 0x3E,  // 8
+    [0x3F] = 0x0A,  // F8
+    [0x41] = 0x41,  // ,
+    [0x42] = 0x42,  // K
+    [0x43] = 0x43,  // I
+    [0x44] = 0x44,  // O
+    [0x45] = 0x45,  // 0
+    [0x46] = 0x46,  // 9
+    [0x47] = 0x01,  // F9
+    [0x49] = 0x49,  // .
+    [0x4A] = 0x4A,  // /
+    [0x4B] = 0x4B,  // L
+    [0x4C] = 0x4C,  // ;
+    [0x4D] = 0x4D,  // P
+    [0x4E] = 0x4E,  // -
+    [0x4F] = 0x09,  // F10
+    [0x51] = 0x51,  // JIS Ro
+    [0x52] = 0x52,  // '
+    [0x53] = 0x5D,  // ISO #
+    [0x54] = 0x54,  // [
+    [0x55] = 0x55,  // =
+    [0x56] = 0x78,  // F11
+    [0x57] = PRINT_SCREEN,
+    [0x58] = 0x94,  // RCtrl
+    [0x59] = 0x59,  // RShift
+    [0x5A] = 0x5A,  // Enter
+    [0x5B] = 0x5B,  // ]
+    [0x5C] = 0x5D,  // Backslash
+    [0x5D] = 0x6A,  // JIS Yen
+    [0x5E] = 0x07,  // F12
+    [0x5F] = 0x7E,  // ScrollLock
+    [0x60] = 0xF2,  // Down
+    [0x61] = 0xEB,  // Left
+    [0x62] = PAUSE,
+    [0x63] = 0xF5,  // Up
+    [0x64] = 0xF1,  // Delete
+    [0x65] = 0xE9,  // End
+    [0x66] = 0x66,  // Backspace
+    [0x67] = 0xF0,  // Insert
+    [0x69] = 0x69,  // KP1
+    [0x6A] = 0xF4,  // Right
+    [0x6B] = 0x6B,  // KP4
+    [0x6C] = 0x6C,  // KP7
+    [0x6D] = 0xFA,  // PageDown
+    [0x6E] = 0xEC,  // Home
+    [0x6F] = 0xFD,  // PageUp
+    [0x70] = 0x70,  // KP0
+    [0x71] = 0x71,  // KP.
+    [0x72] = 0x72,  // KP2
+    [0x73] = 0x73,  // KP5
+    [0x74] = 0x74,  // KP6
+    [0x75] = 0x75,  // KP8
+    [0x76] = 0x77,  // NumLock
+    [0x77] = 0xCA,  // KP/
+    [0x79] = 0xDA,  // KP Enter
+    [0x7A] = 0x7A,  // KP3
+    [0x7C] = 0x79,  // KP+
+    [0x7D] = 0x7D,  // KP9
+    [0x7E] = 0x7C,  // KP*
+    [0x84] = 0x7B,  // KP-
+    [0x85] = 0x67,  // JIS Muhenkan
+    [0x86] = 0x64,  // JIS Henkan
+    [0x87] = 0x13,  // JIS Katakana/Hiragana
+    [0x8B] = 0x9F,  // LGUI
+    [0x8C] = 0xA7,  // RGUI
+    [0x8D] = 0xAF,  // Apps
+};
+
+static void set3_decode(uint8_t code)
 {
+    static bool f0 = false;
 
-    // scan code reading states
-    static enum {
-        INIT,
-        F0,
-        E0,
-        E0_F0,
-        // Pause
-        E1,
-        E1_14,
-        E1_14_77,
-        E1_14_77_E1,
-        E1_14_77_E1_F0,
-        E1_14_77_E1_F0_14,
-        E1_14_77_E1_F0_14_F0,
-        // Control'd Pause
-        E0_7E,
-        E0_7E_E0,
-        E0_7E_E0_F0,
-    } state = INIT;
+    if (code == 0xF0) {
+        f0 = true;
+        return;
+    }
+
+    uint8_t pos = (code < sizeof(set3_to_set2) ? pgm_read_byte(&set3_to_set2[code]) : 0);
+    if (pos) {
+        if (f0) {
+            matrix_break(pos);
+        } else {
+            matrix_make(pos);
+        }
+    } else if (code == 0x00) {  // Overrun
+        matrix_clear();
+        clear_keyboard();
+        print("Overrun\n");
+    } else {
+        xprintf("unexpected Set 3 code: %02X\n", code);
+    }
+    f0 = false;
+}
 
+/* returns false and leaves keyboard in Set 2 if it refuses Set 3 */
+static bool set3_config(void)
+{
+    uint8_t set = 0;
+    if (ps2_host_send(0xF0) == PS2_ACK && ps2_host_send(0x03) == PS2_ACK &&
+        // read back current set, some keyboards ACK but ignore Set 3
+        ps2_host_send(0xF0) == PS2_ACK && ps2_host_send(0x00) == PS2_ACK &&
+        (set = ps2_host_recv_response()) == 0x03 &&
+        // all keys make/break, no typematic
+        ps2_host_send(0xF8) == PS2_ACK) {
+        print("Scan Code Set 3\n");
+        return true;
+    }
+    xprintf("Set 3 refused(%02X): Set 2\n", set);
+    ps2_host_send(0xF0);
+    ps2_host_send(0x02);
+    return false;
+}
+#endif
 
+uint8_t matrix_scan(void)
+{
     is_modified = false;
 
     // 'pseudo break code' hack
-    if (matrix_is_on(ROW(PAUSE), COL(PAUSE))) {
+    if (scan_set == 2 && matrix_is_on(ROW(PAUSE), COL(PAUSE))) {
         matrix_break(PAUSE);
     }
 
     uint8_t code = ps2_host_recv();
     if (!ps2_error) {
-        switch (state) {
-            case INIT:
-                switch (code) {
-                    case 0xE0:
-                        state = E0;
-                        break;
-                    case 0xF0:
-                        state = F0;
-                        break;
-                    case 0xE1:
-                        state = E1;
-                        break;
-                    case 0x83:  // F7
-                        matrix_make(F7);
-                        state = INIT;
-                        break;
-                    case 0x84:  // Alt'd PrintScreen
-                        matrix_make(PRINT_SCREEN);
-                        state = INIT;
-                        break;
-                    case 0x00:  // Overrun [3]p.25
-                        matrix_clear();
-                        clear_keyboard();
-                        print("Overrun\n");
-                        state = INIT;
-                        break;
-                    default:    // normal key make
-                        if (code < 0x80) {
-                            matrix_make(code);
-                        } else {
-                            matrix_clear();
-                            clear_keyboard();
-                            xprintf("unexpected scan code at INIT: %02X\n", code);
-                        }
-                        state = INIT;
-                }
-                break;
-            case E0:    // E0-Prefixed
-                switch (code) {
-                    case 0x12:  // to be ignored
-                    case 0x59:  // to be ignored
-                        state = INIT;
-                        break;
-                    case 0x7E:  // Control'd Pause
-                        state = E0_7E;
-                        break;
-                    case 0xF0:
-                        state = E0_F0;
-                        break;
-                    default:
-                        if (code < 0x80) {
-                            matrix_make(code|0x80);
-                        } else {
-                            matrix_clear();
-                            clear_keyboard();
-                            xprintf("unexpected scan code at E0: %02X\n", code);
-                        }
-                        state = INIT;
-                }
-                break;
-            case F0:    // Break code
-                switch (code) {
-                    case 0x83:  // F7
-                        matrix_break(F7);
-                        state = INIT;
-                        break;
-                    case 0x84:  // Alt'd PrintScreen
-                        matrix_break(PRINT_SCREEN);
-                        state = INIT;
-                        break;
-                    case 0xF0:
-                        matrix_clear();
-                        clear_keyboard();
-                        xprintf("unexpected scan code at F0: F0(clear and cont.)\n");
-                        break;
-                    default:
-                    if (code < 0x80) {
-                        matrix_break(code);
-                    } else {
-                        matrix_clear();
-                        clear_keyboard();
-                        xprintf("unexpected scan code at F0: %02X\n", code);
-                    }
-                    state = INIT;
-                }
-                break;
-            case E0_F0: // Break code of E0-prefixed
-                switch (code) {
-                    case 0x12:  // to be ignored
-                    case 0x59:  // to be ignored
-                        state = INIT;
-                        break;
-                    default:
-                        if (code < 0x80) {
-                            matrix_break(code|0x80);
-                        } else {
-                            matrix_clear();
-                            clear_keyboard();
-                            xprintf("unexpected scan code at E0_F0: %02X\n", code);
-                        }
-                        state = INIT;
-                }
-                break;
-            // following are states of Pause
-            case E1:
-                switch (code) {
-                    case 0x14:
-                        state = E1_14;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14:
-                switch (code) {
-                    case 0x77:
-                        state = E1_14_77;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14_77:
-                switch (code) {
-                    case 0xE1:
-                        state = E1_14_77_E1;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14_77_E1:
-                switch (code) {
-                    case 0xF0:
-                        state = E1_14_77_E1_F0;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14_77_E1_F0:
-                switch (code) {
-                    case 0x14:
-                        state = E1_14_77_E1_F0_14;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14_77_E1_F0_14:
-                switch (code) {
-                    case 0xF0:
-                        state = E1_14_77_E1_F0_14_F0;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            case E1_14_77_E1_F0_14_F0:
-                switch (code) {
-                    case 0x77:
-                        matrix_make(PAUSE);
-                        state = INIT;
-                        break;
-                    default:
-                        state = INIT;
-                }
-                break;
-            // Following are states of Control'd Pause
-            case E0_7E:
-                if (code == 0xE0)
-                    state = E0_7E_E0;
-                else
-                    state = INIT;
-                break;
-            case E0_7E_E0:
-                if (code == 0xF0)
-                    state = E0_7E_E0_F0;
-                else
-                    state = INIT;
-                break;
-            case E0_7E_E0_F0:
-                if (code == 0x7E)
-                    matrix_make(PAUSE);
-                state = INIT;
-                break;
-            default:
-                state = INIT;
-        }
+#ifdef PS2_USE_SET3
+        if (code == 0xAA) {
+            // BAT completion: keyboard is plugged in or reset to Set 2
+            matrix_clear();
+            clear_keyboard();
+            state = INIT;
+            scan_set = (set3_config() ? 3 : 2);
+        } else if (scan_set == 3) {
+            set3_decode(code);
+        } else
+#endif
+        set2_decode(code);
     }
 
     // TODO: request RESEND when error occurs?
@@ -0,0 +1,17 @@
+/* matrix.c built with matrix_* renamed to new_* to link both decoders */
+#define matrix_rows         new_rows
+#define matrix_cols         new_cols
+#define matrix_init         new_init
+#define matrix_scan         new_scan
+#define matrix_is_modified  new_is_modified
+#define matrix_has_ghost    new_has_ghost
+#define matrix_is_on        new_is_on
+#define matrix_get_row      new_get_row
+#define matrix_print        new_print
+#define matrix_key_count    new_key_count
+#include "matrix.h"
+bool new_is_on(uint8_t row, uint8_t col);
+
+#include "../matrix.c"
+
+uint8_t *new_matrix(void) { return matrix; }
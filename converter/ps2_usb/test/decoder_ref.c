@@ -0,0 +1,17 @@
+/* matrix.c built with matrix_* renamed to ref_* to link both decoders */
+#define matrix_rows         ref_rows
+#define matrix_cols         ref_cols
+#define matrix_init         ref_init
+#define matrix_scan         ref_scan
+#define matrix_is_modified  ref_is_modified
+#define matrix_has_ghost    ref_has_ghost
+#define matrix_is_on        ref_is_on
+#define matrix_get_row      ref_get_row
+#define matrix_print        ref_print
+#define matrix_key_count    ref_key_count
+#include "matrix.h"
+bool ref_is_on(uint8_t row, uint8_t col);
+
+#include "matrix_ref.c"
+
+uint8_t *ref_matrix(void) { return matrix; }
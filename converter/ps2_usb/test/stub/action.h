@@ -0,0 +1,3 @@
+#include <stdint.h>
+extern int clears;
+static inline void clear_keyboard(void) { clears++; }
@@ -0,0 +1,2 @@
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
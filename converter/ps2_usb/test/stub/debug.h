@@ -0,0 +1 @@
+extern int debug_enable;
@@ -0,0 +1,5 @@
+#include <stdint.h>
+#include <stdbool.h>
+#define MATRIX_ROWS 32
+#define MATRIX_COLS 8
+bool matrix_is_on(uint8_t row, uint8_t col);
@@ -0,0 +1,4 @@
+#define print(s)            ((void)0)
+#define xprintf(...)        ((void)0)
+#define phex(x)             ((void)0)
+#define pbin_reverse(x)     ((void)0)
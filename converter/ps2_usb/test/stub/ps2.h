@@ -0,0 +1,18 @@
+#ifndef PS2_H
+#define PS2_H
+#include <stdint.h>
+#include <stdbool.h>
+#define PS2_ACK         0xFA
+#define PS2_RESEND      0xFE
+#define PS2_SET_LED     0xED
+#define PS2_LED_SCROLL_LOCK 0
+#define PS2_LED_NUM_LOCK    1
+#define PS2_LED_CAPS_LOCK   2
+extern uint8_t ps2_error;
+static inline void ps2_host_init(void) {}
+uint8_t ps2_host_recv(void);
+uint8_t ps2_host_send(uint8_t data);
+bool ps2_host_send_async(uint8_t data);
+uint8_t ps2_host_recv_response(void);
+void ps2_host_set_led(uint8_t usb_led);
+#endif
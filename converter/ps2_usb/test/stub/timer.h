@@ -0,0 +1,3 @@
+#include <stdint.h>
+uint16_t timer_read(void);
+uint16_t timer_elapsed(uint16_t last);
@@ -0,0 +1,2 @@
+#include <stdint.h>
+static inline uint8_t bitpop(uint8_t b) { return __builtin_popcount(b); }
@@ -0,0 +1,2 @@
+#define _delay_ms(ms)
+#define _delay_us(us)
@@ -0,0 +1,108 @@
+/*
+ * Host test: PS/2 command queue of protocol/ps2_cmd.c
+ *
+ * Keyboard is simulated by driver hooks: each byte sent is answered with a
+ * scripted reply which is fed through receive ISR path, ps2_cmd_rx() first
+ * and then receive buffer. Typing during LED update puts scan codes ahead of
+ * ACK; command must still complete and scan codes must come out in order.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "ps2.h"
+#include "ps2_cmd.h"
+
+uint8_t ps2_error;
+
+static uint16_t now;
+uint16_t timer_read(void) { return now; }
+uint16_t timer_elapsed(uint16_t last) { return ++now - last; }
+
+/* bytes received by driver */
+static uint8_t rcv[32];
+static int rcv_len;
+static void isr(uint8_t data)
+{
+    if (!ps2_cmd_rx(data))
+        rcv[rcv_len++] = data;
+}
+
+/* bytes sent to keyboard and scripted replies to them */
+static uint8_t sent[16];
+static int sent_len;
+static const uint8_t *reply[16];
+static int reply_len[16];
+static bool replied;
+
+void ps2_cmd_tx_start(uint8_t data)
+{
+    sent[sent_len++] = data;
+    replied = false;
+}
+
+uint8_t ps2_cmd_tx_state(void)
+{
+    if (!replied) {
+        int n = sent_len - 1;
+        for (int i = 0; i < reply_len[n]; i++) isr(reply[n][i]);
+        replied = true;
+    }
+    return PS2_TX_DONE;
+}
+
+static void setup(void)
+{
+    now = 0;
+    rcv_len = sent_len = 0;
+    memset(reply_len, 0, sizeof(reply_len));
+}
+
+#define REPLY(n, ...) do { \
+    static const uint8_t r[] = { __VA_ARGS__ }; \
+    reply[n] = r; reply_len[n] = sizeof(r); \
+} while (0)
+
+static int check(const char *name, const uint8_t *exp_sent, int ns, const uint8_t *exp_rcv, int nr)
+{
+    bool ok = (sent_len == ns && !memcmp(sent, exp_sent, ns) &&
+               rcv_len == nr && !memcmp(rcv, exp_rcv, nr) && now < 25);
+    printf("%s: %s\n", name, ok ? "ok" : "NG");
+    if (!ok) {
+        printf("  sent:"); for (int i = 0; i < sent_len; i++) printf(" %02X", sent[i]);
+        printf("\n  rcv: "); for (int i = 0; i < rcv_len; i++) printf(" %02X", rcv[i]);
+        printf("\n  time: %u\n", now);
+    }
+    return !ok;
+}
+
+int main(void)
+{
+    int fail = 0;
+
+    /* 'A' pressed before ACK of 0xED, released before ACK of LED byte */
+    setup();
+    REPLY(0, 0x1C, PS2_ACK);
+    REPLY(1, 0xF0, 0x1C, PS2_ACK);
+    ps2_host_set_led(1<<PS2_LED_CAPS_LOCK);
+    ps2_cmd_flush();
+    fail |= check("typing during LED update",
+                  (uint8_t[]){ 0xED, 0x04 }, 2, (uint8_t[]){ 0x1C, 0xF0, 0x1C }, 3);
+
+    /* RESEND is retried and scan code after it is kept */
+    setup();
+    REPLY(0, PS2_RESEND, 0x1C);
+    REPLY(1, PS2_ACK);
+    REPLY(2, PS2_ACK);
+    ps2_host_set_led(1<<PS2_LED_NUM_LOCK);
+    ps2_cmd_flush();
+    fail |= check("resend",
+                  (uint8_t[]){ 0xED, 0xED, 0x02 }, 3, (uint8_t[]){ 0x1C }, 1);
+
+    /* ACK is not taken from receive stream while no command is waiting */
+    setup();
+    isr(PS2_ACK);
+    fail |= check("no command", NULL, 0, (uint8_t[]){ PS2_ACK }, 1);
+
+    return fail;
+}
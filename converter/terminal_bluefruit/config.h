@@ -44,6 +44,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
     (keyboard_report->mods == (MOD_BIT(KC_RALT) | MOD_BIT(KC_RCTL)))  \
 )
 
+#define BOOTMAGIC_SLOW_START
+
 /* USART configuration
  *     asynchronous, 9600baud, 8-data bit, non parity, 1-stop bit, no flow control
  */
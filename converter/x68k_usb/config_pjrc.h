@@ -38,6 +38,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
     keyboard_report->mods == (MOD_BIT(KC_LCTL) | MOD_BIT(KC_RCTL)) \
 )
 
+#define BOOTMAGIC_SLOW_START
+
 /* legacy keymap support */
 #define USE_LEGACY_KEYMAP
 
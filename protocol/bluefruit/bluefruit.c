@@ -35,7 +35,7 @@ static void bluefruit_serial_send(uint8_t);
 
 void bluefruit_keyboard_print_report(report_keyboard_t *report)
 {
-    if (!debug_keyboard) return;
+    if (!log_active(HOST, LOG_LEVEL_DEBUG)) return;
     dprintf("keys: "); for (int i = 0; i < REPORT_KEYS; i++) { debug_hex8(report->keys[i]); dprintf(" "); }
     dprintf(" mods: "); debug_hex8(report->mods);
     dprintf(" reserved: "); debug_hex8(report->reserved); 
@@ -72,7 +72,7 @@ static void bluefruit_serial_send(uint8_t data)
 
 static uint8_t keyboard_leds(void);
 static void send_keyboard(report_keyboard_t *report);
-static void send_mouse(report_mouse_t *report);
+static bool send_mouse(report_mouse_t *report);
 static void send_system(uint16_t data);
 static void send_consumer(uint16_t data);
 
@@ -107,7 +107,7 @@ static void send_keyboard(report_keyboard_t *report)
 #endif
 }
 
-static void send_mouse(report_mouse_t *report)
+static bool send_mouse(report_mouse_t *report)
 {
 #ifdef BLUEFRUIT_TRACE_SERIAL   
     bluefruit_trace_header();
@@ -124,6 +124,7 @@ static void send_mouse(report_mouse_t *report)
 #ifdef BLUEFRUIT_TRACE_SERIAL
     bluefruit_trace_footer();
 #endif
+    return true;
 }
 
 static void send_system(uint16_t data)
@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "sendchar.h"
 #include "suspend.h"
+#include "adaptive_scan.h"
 #include "bluefruit.h"
 #include "pjrc.h"
 
@@ -86,6 +87,8 @@ int main(void)
         dprintf("Starting main loop");
         while (1) {
             keyboard_task();
+            // scan slowly when idle to save battery
+            adaptive_scan_wait();
         }
 
     } else {
@@ -36,6 +36,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "host_driver.h"
 #include "iwrap.h"
 #include "print.h"
+#include "ringbuf.h"
 
 
 /* iWRAP MUX mode utils. 3.10 HID raw mode(iWRAP_HID_Application_Note.pdf) */
@@ -56,44 +57,30 @@ static uint8_t connected = 0;
 static char buf[MUX_BUF_SIZE];
 static uint8_t snd_pos = 0;
 
-#define MUX_RCV_BUF_SIZE 256
-static char rcv_buf[MUX_RCV_BUF_SIZE];
-static uint8_t rcv_head = 0;
-static uint8_t rcv_tail = 0;
-
-
-/* receive buffer */
-static void rcv_enq(char c)
-{
-    uint8_t next = (rcv_head + 1) % MUX_RCV_BUF_SIZE;
-    if (next != rcv_tail) {
-        rcv_buf[rcv_head] = c;
-        rcv_head = next;
-    }
-}
+/* receive buffer: responses are copied out with rcv_copy() and parsed there */
+RINGBUF_DEFINE(rcv, 256);
 
 static char rcv_deq(void)
 {
-    char c = 0;
-    if (rcv_head != rcv_tail) {
-        c = rcv_buf[rcv_tail++];
-        rcv_tail %= MUX_RCV_BUF_SIZE;
-    }
-    return c;
+    int16_t c = rcv_get();
+    return (c < 0 ? 0 : c);
 }
 
-/*
-static char rcv_peek(void)
+static void rcv_rewind(void)
 {
-    if (rcv_head == rcv_tail)
-        return 0;
-    return rcv_buf[rcv_tail];
+    uint8_t sreg = SREG;
+    cli();
+    rcv_reset();
+    SREG = sreg;
 }
-*/
 
-static void rcv_clear(void)
+/* copy size-1 bytes from rcv_data[pos] into dst and terminate it */
+static char *rcv_copy(char *dst, uint8_t pos, uint8_t size)
 {
-    rcv_tail = rcv_head = 0;
+    for (uint8_t i = 0; i < size - 1; i++)
+        dst[i] = rcv_data[(uint8_t)(pos + i) & (sizeof(rcv_data) - 1)];
+    dst[size - 1] = '\0';
+    return dst;
 }
 
 /* iWRAP response */
@@ -127,7 +114,7 @@ ISR(PCINT1_vect, ISR_BLOCK) // recv() runs away in case of ISR_NOBLOCK
         default:
             if (mux_state--) {
                 uart_putchar(c);
-                rcv_enq(c);
+                rcv_put(c);
             }
     }
 }
@@ -149,7 +136,7 @@ void iwrap_init(void)
 
 void iwrap_mux_send(const char *s)
 {
-    rcv_clear();
+    rcv_rewind();
     MUX_HEADER(0xff, strlen((char *)s));
     iwrap_send(s);
     MUX_FOOTER(0xff);
@@ -184,20 +171,22 @@ void iwrap_buf_send(void)
 
 void iwrap_call(void)
 {
+    char line[40];
     char *p;
 
     iwrap_mux_send("SET BT PAIR");
     _delay_ms(500);
 
-    p = rcv_buf + rcv_tail;
-    while (!strncmp(p, "SET BT PAIR", 11)) {
-        p += 7;
+    // iwrap_mux_send() below resets rcv, so keep our own read position
+    uint8_t pos = rcv.tail;
+    while (!strncmp(rcv_copy(line, pos, sizeof(line)), "SET BT PAIR", 11)) {
+        p = line + 7;
         strncpy(p, "CALL", 4);
         strncpy(p+22, " 11 HID\n\0", 9);
         print_S(p);
         iwrap_mux_send(p);
         // TODO: skip to next line
-        p += 57;
+        pos += 64;
 
         DEBUG_LED_CONFIG;
         DEBUG_LED_ON;
@@ -227,11 +216,12 @@ void iwrap_call(void)
 void iwrap_kill(void)
 {
     char c;
+    char line[24];
     iwrap_mux_send("LIST");
     _delay_ms(500);
 
     while ((c = rcv_deq()) && c != '\n') ;
-    if (strncmp(rcv_buf + rcv_tail, "LIST ", 5)) {
+    if (strncmp(rcv_copy(line, rcv.tail, 6), "LIST ", 5)) {
         print("no connection to kill.\n");
         return;
     }
@@ -239,7 +229,7 @@ void iwrap_kill(void)
     for (uint8_t i = 10; i; i--)
         while ((c = rcv_deq()) && c != ' ') ;
 
-    char *p = rcv_buf + rcv_tail - 5;
+    char *p = rcv_copy(line, rcv.tail - 5, sizeof(line));
     strncpy(p, "KILL ", 5);
     strncpy(p + 22, "\n\0", 2);
     print_S(p);
@@ -254,7 +244,8 @@ void iwrap_unpair(void)
     iwrap_mux_send("SET BT PAIR");
     _delay_ms(500);
 
-    char *p = rcv_buf + rcv_tail;
+    char line[32];
+    char *p = rcv_copy(line, rcv.tail, sizeof(line));
     if (!strncmp(p, "SET BT PAIR", 11)) {
         strncpy(p+29, "\n\0", 2);
         print_S(p);
@@ -277,7 +268,8 @@ void iwrap_subrate(void)
 
 bool iwrap_failed(void)
 {
-    if (strncmp(rcv_buf, "SYNTAX ERROR", 12))
+    char line[13];
+    if (strncmp(rcv_copy(line, 0, sizeof(line)), "SYNTAX ERROR", 12))
         return true;
     else
         return false;
@@ -290,10 +282,12 @@ uint8_t iwrap_connected(void)
 
 uint8_t iwrap_check_connection(void)
 {
+    char line[7];
     iwrap_mux_send("LIST");
     _delay_ms(100);
 
-    if (strncmp(rcv_buf, "LIST ", 5) || !strncmp(rcv_buf, "LIST 0", 6))
+    rcv_copy(line, 0, sizeof(line));
+    if (strncmp(line, "LIST ", 5) || !strncmp(line, "LIST 0", 6))
         connected = 0;
     else
         connected = 1;
@@ -306,7 +300,7 @@ uint8_t iwrap_check_connection(void)
  *------------------------------------------------------------------*/
 static uint8_t keyboard_leds(void);
 static void send_keyboard(report_keyboard_t *report);
-static void send_mouse(report_mouse_t *report);
+static bool send_mouse(report_mouse_t *report);
 static void send_system(uint16_t data);
 static void send_consumer(uint16_t data);
 
@@ -347,10 +341,10 @@ static void send_keyboard(report_keyboard_t *report)
     MUX_FOOTER(0x01);
 }
 
-static void send_mouse(report_mouse_t *report)
+static bool send_mouse(report_mouse_t *report)
 {
 #if defined(MOUSEKEY_ENABLE) || defined(PS2_MOUSE_ENABLE)
-    if (!iwrap_connected() && !iwrap_check_connection()) return;
+    if (!iwrap_connected() && !iwrap_check_connection()) return true;
     MUX_HEADER(0x01, 0x09);
     // HID raw mode header
     xmit(0x9f);
@@ -364,6 +358,7 @@ static void send_mouse(report_mouse_t *report)
     xmit(report->h);
     MUX_FOOTER(0x01);
 #endif
+    return true;
 }
 
 static void send_system(uint16_t data)
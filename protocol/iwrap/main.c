@@ -37,6 +37,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "keycode.h"
 #include "command.h"
+#include "adaptive_scan.h"
 
 
 static void sleep(uint8_t term);
@@ -187,6 +188,9 @@ int main(void)
                 _delay_ms(1);   // wait for UART to send
                 iwrap_sleep();
                 sleep(WDTO_60MS);
+            } else {
+                // scan slowly when idle to save battery
+                adaptive_scan_wait();
             }
         }
     }
@@ -151,7 +151,11 @@ typedef struct
 #define MOUSE_EPSIZE                8
 #define EXTRAKEY_EPSIZE             8
 #define CONSOLE_EPSIZE              32
-#define NKRO_EPSIZE                 16
+#define NKRO_EPSIZE                 64
+
+/* NKRO report: modifier byte and bitmap of all 256 keycodes */
+#define NKRO_REPORT_BITS            32
+#define NKRO_REPORT_SIZE            (1 + NKRO_REPORT_BITS)
 
 
 uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
@@ -44,6 +44,7 @@
 #include "led.h"
 #include "sendchar.h"
 #include "debug.h"
+#include "latency.h"
 #ifdef SLEEP_LED_ENABLE
 #include "sleep_led.h"
 #endif
@@ -62,9 +63,13 @@ static report_keyboard_t keyboard_report_sent;
 /* Host driver */
 static uint8_t keyboard_leds(void);
 static void send_keyboard(report_keyboard_t *report);
-static void send_mouse(report_mouse_t *report);
+static bool send_mouse(report_mouse_t *report);
 static void send_system(uint16_t data);
 static void send_consumer(uint16_t data);
+static void flush_reports(void);
+static void clear_pending_reports(void);
+static void clear_keyboard_queue(void);
+static void keyboard_idle_task(void);
 host_driver_t lufa_driver = {
     keyboard_leds,
     send_keyboard,
@@ -78,6 +83,25 @@ host_driver_t lufa_driver = {
  * Console
  ******************************************************************************/
 #ifdef CONSOLE_ENABLE
+/*
+ * sendchar() only puts character in this buffer and never waits for host.
+ * Buffer is drained from SOF event in CONSOLE_EPSIZE packets, characters are
+ * dropped when it is full and counted in console_dropped, the count is sent
+ * as "[dropped:XXXX]" once buffer is drained.
+ */
+#ifndef CONSOLE_BUFFER_SIZE
+#define CONSOLE_BUFFER_SIZE 128
+#endif
+#if CONSOLE_BUFFER_SIZE > 255
+#error "CONSOLE_BUFFER_SIZE must be 255 or less"
+#endif
+static uint8_t console_buf[CONSOLE_BUFFER_SIZE];
+static uint8_t console_head = 0;
+static uint8_t console_tail = 0;
+static uint8_t console_len = 0;
+static uint16_t console_dropped = 0;
+
+/* called from SOF event with interrupt disabled */
 static void Console_Task(void)
 {
     /* Device must be connected and configured for the task to run */
@@ -111,20 +135,42 @@ static void Console_Task(void)
     }
 #endif
 
-    /* IN packet */
+    /* IN packet: drain console buffer a packet per free bank */
     Endpoint_SelectEndpoint(CONSOLE_IN_EPNUM);
     if (!Endpoint_IsEnabled() || !Endpoint_IsConfigured()) {
         Endpoint_SelectEndpoint(ep);
         return;
     }
 
-    // fill empty bank
-    while (Endpoint_IsReadWriteAllowed())
-        Endpoint_Write_8(0);
+    while (console_len && Endpoint_IsReadWriteAllowed()) {
+        uint8_t n = CONSOLE_EPSIZE;
+        while (n && console_len) {
+            Endpoint_Write_8(console_buf[console_tail]);
+            if (++console_tail == CONSOLE_BUFFER_SIZE) console_tail = 0;
+            console_len--;
+            n--;
+        }
+        // pad packet with zero
+        while (n--)
+            Endpoint_Write_8(0);
+        Endpoint_ClearIN();
+    }
 
-    // flash senchar packet
-    if (Endpoint_IsINReady()) {
+    if (!console_len && console_dropped && Endpoint_IsReadWriteAllowed()) {
+        static const char mark[] = "\n[dropped:";
+        uint8_t n = CONSOLE_EPSIZE;
+        for (const char *p = mark; *p; p++, n--)
+            Endpoint_Write_8(*p);
+        for (int8_t i = 12; i >= 0; i -= 4, n--) {
+            uint8_t d = (console_dropped >> i) & 0xF;
+            Endpoint_Write_8(d < 10 ? '0' + d : 'A' - 10 + d);
+        }
+        Endpoint_Write_8(']'); n--;
+        Endpoint_Write_8('\n'); n--;
+        while (n--)
+            Endpoint_Write_8(0);
         Endpoint_ClearIN();
+        console_dropped = 0;
     }
 
     Endpoint_SelectEndpoint(ep);
@@ -152,10 +198,18 @@ void EVENT_USB_Device_Connect(void)
 
 void EVENT_USB_Device_Disconnect(void)
 {
+    clear_keyboard_queue();
 }
 
 void EVENT_USB_Device_Reset(void)
 {
+    // keystrokes queued for previous host must not be replayed to next one
+    clear_keyboard_queue();
+    // report protocol is default after reset
+    protocol_report = 1;
+#ifdef NKRO_ENABLE
+    keyboard_nkro = true;
+#endif
 }
 
 void EVENT_USB_Device_Suspend()
@@ -178,6 +232,8 @@ void EVENT_USB_Device_WakeUp()
 
 void EVENT_USB_Device_StartOfFrame(void)
 {
+    flush_reports();
+    keyboard_idle_task();
     Console_Task();
 }
 
@@ -197,20 +253,22 @@ void EVENT_USB_Device_ConfigurationChanged(void)
 {
     bool ConfigSuccess = true;
 
+    clear_pending_reports();
+
     /* Setup Keyboard HID Report Endpoints */
     ConfigSuccess &= ENDPOINT_CONFIG(KEYBOARD_IN_EPNUM, EP_TYPE_INTERRUPT, ENDPOINT_DIR_IN,
-                                     KEYBOARD_EPSIZE, ENDPOINT_BANK_SINGLE);
+                                     KEYBOARD_EPSIZE, ENDPOINT_BANK_DOUBLE);
 
 #ifdef MOUSE_ENABLE
     /* Setup Mouse HID Report Endpoint */
     ConfigSuccess &= ENDPOINT_CONFIG(MOUSE_IN_EPNUM, EP_TYPE_INTERRUPT, ENDPOINT_DIR_IN,
-                                     MOUSE_EPSIZE, ENDPOINT_BANK_SINGLE);
+                                     MOUSE_EPSIZE, ENDPOINT_BANK_DOUBLE);
 #endif
 
 #ifdef EXTRAKEY_ENABLE
     /* Setup Extra HID Report Endpoint */
     ConfigSuccess &= ENDPOINT_CONFIG(EXTRAKEY_IN_EPNUM, EP_TYPE_INTERRUPT, ENDPOINT_DIR_IN,
-                                     EXTRAKEY_EPSIZE, ENDPOINT_BANK_SINGLE);
+                                     EXTRAKEY_EPSIZE, ENDPOINT_BANK_DOUBLE);
 #endif
 
 #ifdef CONSOLE_ENABLE
@@ -224,7 +282,7 @@ void EVENT_USB_Device_ConfigurationChanged(void)
 #ifdef NKRO_ENABLE
     /* Setup NKRO HID Report Endpoints */
     ConfigSuccess &= ENDPOINT_CONFIG(NKRO_IN_EPNUM, EP_TYPE_INTERRUPT, ENDPOINT_DIR_IN,
-                                     NKRO_EPSIZE, ENDPOINT_BANK_SINGLE);
+                                     NKRO_EPSIZE, ENDPOINT_BANK_DOUBLE);
 #endif
 }
 
@@ -314,6 +372,10 @@ void EVENT_USB_Device_ControlRequest(void)
                 Endpoint_ClearStatusStage();
 
                 protocol_report = ((USB_ControlRequest.wValue & 0xFF) != 0x00);
+#ifdef NKRO_ENABLE
+                // fall back to 6KRO when BIOS requests boot protocol
+                keyboard_nkro = protocol_report;
+#endif
             }
 
             break;
@@ -349,99 +411,251 @@ static uint8_t keyboard_leds(void)
     return keyboard_led_stats;
 }
 
-static void send_keyboard(report_keyboard_t *report)
+/*
+ * Reports are not written while endpoint bank is busy. Latest report is held
+ * in pending slot of the endpoint instead and flushed on next SOF, so that
+ * keyboard_task never waits for host and no report is written on busy bank.
+ */
+static bool keyboard_pending = false;
+static uint8_t keyboard_pending_ep = KEYBOARD_IN_EPNUM;
+static uint8_t keyboard_pending_size = KEYBOARD_EPSIZE;
+static report_keyboard_t keyboard_report_pending;
+/*
+ * Keyboard runs while host enumerates device. Reports sent before configured
+ * are queued and delivered in order after configuration, the last entry is
+ * overwritten with the latest state when queue is full.
+ */
+#define KEYBOARD_QUEUE_SIZE 4
+static struct {
+    uint8_t ep;
+    uint8_t size;
+    report_keyboard_t report;
+} keyboard_queue[KEYBOARD_QUEUE_SIZE];
+static uint8_t keyboard_queue_len = 0;
+/* ms since keyboard report was written last time */
+static uint16_t keyboard_idle_ms = 0;
+#ifdef MOUSE_ENABLE
+static bool mouse_pending = false;
+static report_mouse_t mouse_report_pending;
+#endif
+#ifdef EXTRAKEY_ENABLE
+static bool system_pending = false;
+static report_extra_t system_report_pending;
+static bool consumer_pending = false;
+static report_extra_t consumer_report_pending;
+#endif
+
+/* write report if endpoint has free bank, return false when busy */
+static bool write_report(uint8_t ep, void *report, uint8_t size)
 {
-    uint8_t timeout = 0;
+    bool written = false;
+    uint8_t prev_ep = Endpoint_GetCurrentEndpoint();
+
+    Endpoint_SelectEndpoint(ep);
+    if (Endpoint_IsReadWriteAllowed()) {
+        Endpoint_Write_Stream_LE(report, size, NULL);
+        Endpoint_ClearIN();
+        written = true;
+    }
 
+    Endpoint_SelectEndpoint(prev_ep);
+    return written;
+}
+
+/* called with interrupt disabled: from SOF event or send_* functions */
+static void flush_reports(void)
+{
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
-    /* Select the Keyboard Report Endpoint */
-#ifdef NKRO_ENABLE
-    if (keyboard_nkro) {
-        Endpoint_SelectEndpoint(NKRO_IN_EPNUM);
+    /* move next queued report into pending slot */
+    if (!keyboard_pending && keyboard_queue_len) {
+        keyboard_pending_ep = keyboard_queue[0].ep;
+        keyboard_pending_size = keyboard_queue[0].size;
+        keyboard_report_pending = keyboard_queue[0].report;
+        keyboard_pending = true;
+        keyboard_queue_len--;
+        memmove(&keyboard_queue[0], &keyboard_queue[1], keyboard_queue_len * sizeof(keyboard_queue[0]));
+    }
+
+    if (keyboard_pending &&
+            write_report(keyboard_pending_ep, &keyboard_report_pending, keyboard_pending_size)) {
+        keyboard_pending = false;
+        keyboard_report_sent = keyboard_report_pending;
+        latency_mark(LATENCY_USB);
+        keyboard_idle_ms = 0;
+    }
+#ifdef MOUSE_ENABLE
+    if (mouse_pending &&
+            write_report(MOUSE_IN_EPNUM, &mouse_report_pending, sizeof(report_mouse_t))) {
+        mouse_pending = false;
     }
-    else
 #endif
-    {
-        Endpoint_SelectEndpoint(KEYBOARD_IN_EPNUM);
+#ifdef EXTRAKEY_ENABLE
+    if (system_pending &&
+            write_report(EXTRAKEY_IN_EPNUM, &system_report_pending, sizeof(report_extra_t))) {
+        system_pending = false;
     }
+    if (consumer_pending &&
+            write_report(EXTRAKEY_IN_EPNUM, &consumer_report_pending, sizeof(report_extra_t))) {
+        consumer_pending = false;
+    }
+#endif
+}
+
+/* queued reports are kept over configuration but not over bus reset */
+static void clear_keyboard_queue(void)
+{
+    uint8_t sreg = SREG;
+    cli();
+    keyboard_queue_len = 0;
+    keyboard_pending = false;
+    SREG = sreg;
+}
+
+static void clear_pending_reports(void)
+{
+    keyboard_pending = false;
+#ifdef MOUSE_ENABLE
+    mouse_pending = false;
+#endif
+#ifdef EXTRAKEY_ENABLE
+    system_pending = false;
+    consumer_pending = false;
+#endif
+}
+
+/*
+ * HID Idle: report is sent only when it changes, and repeated every
+ * idle_duration*4ms when host sets non-zero idle rate. Driven by SOF event.
+ */
+static void keyboard_idle_task(void)
+{
+    if (!idle_duration || keyboard_pending)
+        return;
+
+    if (++keyboard_idle_ms < (uint16_t)idle_duration * 4)
+        return;
 
-    /* Check if Keyboard Endpoint Ready for Read/Write */
-    while (--timeout && !Endpoint_IsReadWriteAllowed()) ;
+    keyboard_report_pending = keyboard_report_sent;
+    keyboard_pending = true;
+    flush_reports();
+}
+
+static void send_keyboard(report_keyboard_t *report)
+{
+    uint8_t ep, size;
 
-    /* Write Keyboard Report Data */
+    /* Select the Keyboard Report Endpoint by layout of report, not by
+     * keyboard_nkro which ISR may have changed since report was built */
 #ifdef NKRO_ENABLE
-    if (keyboard_nkro) {
-        Endpoint_Write_Stream_LE(report, NKRO_EPSIZE, NULL);
+    if (keyboard_report_nkro) {
+        ep = NKRO_IN_EPNUM;
+        size = NKRO_REPORT_SIZE;
     }
     else
 #endif
     {
         /* boot mode */
-        Endpoint_Write_Stream_LE(report, KEYBOARD_EPSIZE, NULL);
+        ep = KEYBOARD_IN_EPNUM;
+        size = KEYBOARD_EPSIZE;
     }
 
-    /* Finalize the stream transfer to send the last packet */
-    Endpoint_ClearIN();
+    uint8_t sreg = SREG;
+    cli();
 
-    keyboard_report_sent = *report;
-}
-
-static void send_mouse(report_mouse_t *report)
-{
-#ifdef MOUSE_ENABLE
-    uint8_t timeout = 0;
-
-    if (USB_DeviceState != DEVICE_STATE_Configured)
+    /* queue report until configured and keep order while queue drains */
+    if (USB_DeviceState != DEVICE_STATE_Configured || keyboard_queue_len) {
+        uint8_t i = keyboard_queue_len;
+        if (i && keyboard_queue[i - 1].ep == ep &&
+                !memcmp(&keyboard_queue[i - 1].report, report, size)) {
+            SREG = sreg;
+            return;
+        }
+        if (i == KEYBOARD_QUEUE_SIZE)
+            i--;
+        else
+            keyboard_queue_len++;
+        keyboard_queue[i].ep = ep;
+        keyboard_queue[i].size = size;
+        keyboard_queue[i].report = *report;
+        flush_reports();
+        SREG = sreg;
         return;
+    }
 
-    /* Select the Mouse Report Endpoint */
-    Endpoint_SelectEndpoint(MOUSE_IN_EPNUM);
+    /* suppress report which doesn't change */
+    report_keyboard_t *last = keyboard_pending ? &keyboard_report_pending : &keyboard_report_sent;
+    if (ep == keyboard_pending_ep && !memcmp(last, report, size)) {
+        SREG = sreg;
+        return;
+    }
+    keyboard_pending_ep = ep;
+    keyboard_pending_size = size;
 
-    /* Check if Mouse Endpoint Ready for Read/Write */
-    while (--timeout && !Endpoint_IsReadWriteAllowed()) ;
+    /* replaces stale pending report */
+    keyboard_report_pending = *report;
+    keyboard_pending = true;
+    flush_reports();
 
-    /* Write Mouse Report Data */
-    Endpoint_Write_Stream_LE(report, sizeof(report_mouse_t), NULL);
+    SREG = sreg;
+}
 
-    /* Finalize the stream transfer to send the last packet */
-    Endpoint_ClearIN();
+static bool send_mouse(report_mouse_t *report)
+{
+#ifdef MOUSE_ENABLE
+    /* no host to keep motion for */
+    if (USB_DeviceState != DEVICE_STATE_Configured)
+        return true;
+
+    bool accepted = false;
+    uint8_t sreg = SREG;
+    cli();
+    flush_reports();
+    /* pending slot is never overwritten */
+    if (!mouse_pending) {
+        mouse_report_pending = *report;
+        mouse_pending = true;
+        flush_reports();
+        accepted = true;
+    }
+    SREG = sreg;
+    return accepted;
+#else
+    return true;
 #endif
 }
 
 static void send_system(uint16_t data)
 {
-    uint8_t timeout = 0;
-
+#ifdef EXTRAKEY_ENABLE
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
-    report_extra_t r = {
-        .report_id = REPORT_ID_SYSTEM,
-        .usage = data
-    };
-    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
-    while (--timeout && !Endpoint_IsReadWriteAllowed()) ;
-    Endpoint_Write_Stream_LE(&r, sizeof(report_extra_t), NULL);
-    Endpoint_ClearIN();
+    uint8_t sreg = SREG;
+    cli();
+    system_report_pending.report_id = REPORT_ID_SYSTEM;
+    system_report_pending.usage = data;
+    system_pending = true;
+    flush_reports();
+    SREG = sreg;
+#endif
 }
 
 static void send_consumer(uint16_t data)
 {
-    uint8_t timeout = 0;
-
+#ifdef EXTRAKEY_ENABLE
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
-    report_extra_t r = {
-        .report_id = REPORT_ID_CONSUMER,
-        .usage = data
-    };
-    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
-    while (--timeout && !Endpoint_IsReadWriteAllowed()) ;
-    Endpoint_Write_Stream_LE(&r, sizeof(report_extra_t), NULL);
-    Endpoint_ClearIN();
+    uint8_t sreg = SREG;
+    cli();
+    consumer_report_pending.report_id = REPORT_ID_CONSUMER;
+    consumer_report_pending.usage = data;
+    consumer_pending = true;
+    flush_reports();
+    SREG = sreg;
+#endif
 }
 
 
@@ -449,60 +663,21 @@ static void send_consumer(uint16_t data)
  * sendchar
  ******************************************************************************/
 #ifdef CONSOLE_ENABLE
-#define SEND_TIMEOUT 5
 int8_t sendchar(uint8_t c)
 {
-    // Not wait once timeouted.
-    // Because sendchar() is called so many times, waiting each call causes big lag.
-    static bool timeouted = false;
-
-    if (USB_DeviceState != DEVICE_STATE_Configured)
-        return -1;
-
-    uint8_t ep = Endpoint_GetCurrentEndpoint();
-    Endpoint_SelectEndpoint(CONSOLE_IN_EPNUM);
-    if (!Endpoint_IsEnabled() || !Endpoint_IsConfigured()) {
-        Endpoint_SelectEndpoint(ep);
-        return -1;
-    }
-
-    if (timeouted && !Endpoint_IsReadWriteAllowed()) {
-        Endpoint_SelectEndpoint(ep);
-        return - 1;
-    }
-
-    timeouted = false;
-
-    uint8_t timeout = SEND_TIMEOUT;
-    uint16_t prevFN = USB_Device_GetFrameNumber();
-    while (!Endpoint_IsReadWriteAllowed()) {
-        switch (USB_DeviceState) {
-        case DEVICE_STATE_Unattached:
-        case DEVICE_STATE_Suspended:
-            return -1;
-        }
-        if (Endpoint_IsStalled()) {
-            Endpoint_SelectEndpoint(ep);
-            return -1;
-        }
-        if (prevFN != USB_Device_GetFrameNumber()) {
-            if (!(timeout--)) {
-                timeouted = true;
-                Endpoint_SelectEndpoint(ep);
-                return -1;
-            }
-            prevFN = USB_Device_GetFrameNumber();
-        }
+    int8_t r = 0;
+    uint8_t sreg = SREG;
+    cli();
+    if (console_len < CONSOLE_BUFFER_SIZE) {
+        console_buf[console_head] = c;
+        if (++console_head == CONSOLE_BUFFER_SIZE) console_head = 0;
+        console_len++;
+    } else {
+        if (console_dropped != 0xFFFF) console_dropped++;
+        r = -1;
     }
-
-    Endpoint_Write_8(c);
-
-    // send when bank is full
-    if (!Endpoint_IsReadWriteAllowed())
-        Endpoint_ClearIN();
-
-    Endpoint_SelectEndpoint(ep);
-    return 0;
+    SREG = sreg;
+    return r;
 }
 #else
 int8_t sendchar(uint8_t c)
@@ -540,17 +715,14 @@ int main(void)
     SetupHardware();
     sei();
 
-    /* wait for USB startup & debug output */
+#if !defined(INTERRUPT_CONTROL_ENDPOINT)
+    /* control requests are polled: blocking init here would stall enumeration */
     while (USB_DeviceState != DEVICE_STATE_Configured) {
-#if defined(INTERRUPT_CONTROL_ENDPOINT)
-        ;
-#else
         USB_USBTask();
-#endif
     }
-    print("USB configured.\n");
+#endif
 
-    /* init modules */
+    /* init modules while host enumerates device, reports are queued until configured */
     keyboard_init();
     host_set_driver(&lufa_driver);
 #ifdef SLEEP_LED_ENABLE
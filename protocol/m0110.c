@@ -323,7 +323,7 @@ static inline uint8_t instant(void)
     m0110_send(M0110_INSTANT);
     uint8_t data = m0110_recv();
     if (data != M0110_NULL) {
-        debug_hex(data); debug(" ");
+        log_debug(PROTOCOL, "%02X ", data);
     }
     return data;
 }
@@ -45,12 +45,10 @@ int main(void)
     // set for 16 MHz clock
     CPU_PRESCALE(0);
 
-    // Initialize the USB, and then wait for the host to set configuration.
-    // If the Teensy is powered without a PC connected to the USB port,
-    // this will wait forever.
+    // Initialize the USB and keyboard while host sets configuration.
+    // Enumeration is handled in USB interrupt, keyboard report made
+    // before configured is sent on first SOF after that.
     usb_init();
-    while (!usb_configured()) /* wait */ ;
-
     print_set_sendchar(sendchar);
 
     keyboard_init();
@@ -28,7 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *------------------------------------------------------------------*/
 static uint8_t keyboard_leds(void);
 static void send_keyboard(report_keyboard_t *report);
-static void send_mouse(report_mouse_t *report);
+static bool send_mouse(report_mouse_t *report);
 static void send_system(uint16_t data);
 static void send_consumer(uint16_t data);
 
@@ -54,10 +54,15 @@ static void send_keyboard(report_keyboard_t *report)
     usb_keyboard_send_report(report);
 }
 
-static void send_mouse(report_mouse_t *report)
+static bool send_mouse(report_mouse_t *report)
 {
 #ifdef MOUSE_ENABLE
-    usb_mouse_send(report->x, report->y, report->v, report->h, report->buttons);
+    if (usb_mouse_send(report->x, report->y, report->v, report->h, report->buttons) == 0)
+        return true;
+    /* no host to keep motion for */
+    return !usb_configured();
+#else
+    return true;
 #endif
 }
 
@@ -215,7 +215,8 @@ static const uint8_t PROGMEM keyboard2_hid_report_desc[] = {
         0x75, 0x03,                     //   Report Size (3),
         0x91, 0x03,                     //   Output (Constant),
         // bitmap of keys
-        0x95, KBD2_REPORT_KEYS*8,       //   Report Count (),
+        0x96, LSB(KBD2_REPORT_KEYS*8),  //   Report Count (),
+              MSB(KBD2_REPORT_KEYS*8),
         0x75, 0x01,                     //   Report Size (1),
         0x15, 0x00,                     //   Logical Minimum (0),
         0x25, 0x01,                     //   Logical Maximum(1),
@@ -399,7 +400,7 @@ static const uint8_t PROGMEM config1_descriptor[CONFIG1_DESC_SIZE] = {
 	KBD_ENDPOINT | 0x80,			// bEndpointAddress
 	0x03,					// bmAttributes (0x03=intr)
 	KBD_SIZE, 0,				// wMaxPacketSize
-	10,					// bInterval
+	KBD_POLLING_INTERVAL,			// bInterval
 
 #ifdef MOUSE_ENABLE
 	// interface descriptor, USB spec 9.6.5, page 267-269, Table 9-12
@@ -490,7 +491,7 @@ static const uint8_t PROGMEM config1_descriptor[CONFIG1_DESC_SIZE] = {
 	EXTRA_ENDPOINT | 0x80,			// bEndpointAddress
 	0x03,					// bmAttributes (0x03=intr)
 	EXTRA_SIZE, 0,				// wMaxPacketSize
-	10,					// bInterval
+	EXTRA_POLLING_INTERVAL,			// bInterval
 #endif
 
 #ifdef NKRO_ENABLE
@@ -677,8 +678,17 @@ ISR(USB_GEN_vect)
 		UECFG1X = EP_SIZE(ENDPOINT0_SIZE) | EP_SINGLE_BUFFER;
 		UEIENX = (1<<RXSTPE);
 		usb_configuration = 0;
+		// report made for previous host must not be sent to next one
+		usb_keyboard_unsent = 0;
+		// report protocol is default after reset
+		usb_keyboard_protocol = 1;
+#ifdef NKRO_ENABLE
+		keyboard_nkro = true;
+#endif
         }
 	if ((intbits & (1<<SOFI)) && usb_configuration) {
+		if (usb_keyboard_unsent && usb_keyboard_resend_report() == 0)
+			usb_keyboard_unsent = 0;
 		t = debug_flush_timer;
 		if (t) {
 			debug_flush_timer = -- t;
@@ -691,27 +701,13 @@ ISR(USB_GEN_vect)
 			}
 		}
                 /* TODO: should keep IDLE rate on each keyboard interface */
-#ifdef NKRO_ENABLE
-		if (!keyboard_nkro && usb_keyboard_idle_config && (++div4 & 3) == 0) {
-#else
 		if (usb_keyboard_idle_config && (++div4 & 3) == 0) {
-#endif
-			UENUM = KBD_ENDPOINT;
-			if (UEINTX & (1<<RWAL)) {
+			if (usb_keyboard_idle_count < usb_keyboard_idle_config)
 				usb_keyboard_idle_count++;
-				if (usb_keyboard_idle_count == usb_keyboard_idle_config) {
+			if (usb_keyboard_idle_count == usb_keyboard_idle_config) {
+				// retry on next 4ms when bank is busy
+				if (usb_keyboard_resend_report() == 0)
 					usb_keyboard_idle_count = 0;
-                                        /* TODO: fix keyboard_report inconsistency */
-/* To avoid Mac SET_IDLE behaviour.
-					UEDATX = keyboard_report_prev->mods;
-					UEDATX = 0;
-                                        uint8_t keys = usb_keyboard_protocol ? KBD_REPORT_KEYS : 6;
-					for (uint8_t i=0; i<keys; i++) {
-						UEDATX = keyboard_report_prev->keys[i];
-					}
-					UEINTX = 0x3A;
-*/
-				}
 			}
 		}
 	}
@@ -929,6 +925,10 @@ ISR(USB_COM_vect)
 				}
 				if (bRequest == HID_SET_PROTOCOL) {
 					usb_keyboard_protocol = wValue;
+#ifdef NKRO_ENABLE
+					// fall back to 6KRO when BIOS requests boot protocol
+					keyboard_nkro = !!usb_keyboard_protocol;
+#endif
 					//usb_wait_in_ready();
 					usb_send_in();
 					return;
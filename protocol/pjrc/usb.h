@@ -124,14 +124,17 @@ void usb_remote_wakeup(void);
 #define KBD_SIZE		8
 #define KBD_BUFFER		EP_DOUBLE_BUFFER
 #define KBD_REPORT_KEYS		(KBD_SIZE - 2)
+#define KBD_POLLING_INTERVAL	1
 
 // secondary keyboard
 #ifdef NKRO_ENABLE
 #define KBD2_INTERFACE		4
 #define KBD2_ENDPOINT		5
-#define KBD2_SIZE		16
+#define KBD2_SIZE		64
 #define KBD2_BUFFER		EP_DOUBLE_BUFFER
-#define KBD2_REPORT_KEYS	(KBD2_SIZE - 1)
+// modifier byte and bitmap of all 256 keycodes
+#define KBD2_REPORT_KEYS	32
+#define KBD2_REPORT_SIZE	(1 + KBD2_REPORT_KEYS)
 #endif
 
 #endif
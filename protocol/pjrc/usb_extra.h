@@ -38,6 +38,7 @@
 #define EXTRA_ENDPOINT		4
 #define EXTRA_SIZE		8
 #define EXTRA_BUFFER		EP_DOUBLE_BUFFER
+#define EXTRA_POLLING_INTERVAL	1
 
 
 int8_t usb_extra_consumer_send(uint16_t bits);
@@ -21,6 +21,7 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include "keycode.h"
@@ -29,6 +30,7 @@
 #include "debug.h"
 #include "util.h"
 #include "host.h"
+#include "latency.h"
 
 
 // protocol setting from the host.  We use exactly the same report
@@ -47,6 +49,15 @@ uint8_t usb_keyboard_idle_count=0;
 // 1=num lock, 2=caps lock, 4=scroll lock, 8=compose, 16=kana
 volatile uint8_t usb_keyboard_leds=0;
 
+// report made before configured, sent on first SOF after configuration
+volatile uint8_t usb_keyboard_unsent=0;
+
+
+// last report sent, repeated on idle timeout
+static report_keyboard_t report_prev;
+static uint8_t report_prev_endpoint = KBD_ENDPOINT;
+static uint8_t report_prev_len = KBD_SIZE;
+
 
 static inline int8_t send_report(report_keyboard_t *report, uint8_t endpoint, uint8_t keys_start, uint8_t keys_end);
 
@@ -54,28 +65,67 @@ static inline int8_t send_report(report_keyboard_t *report, uint8_t endpoint, ui
 int8_t usb_keyboard_send_report(report_keyboard_t *report)
 {
     int8_t result = 0;
+    uint8_t endpoint, len;
 
 #ifdef NKRO_ENABLE
-    if (keyboard_nkro)
-        result = send_report(report, KBD2_ENDPOINT, 0, KBD2_SIZE);
-    else
+    if (keyboard_report_nkro) {
+        endpoint = KBD2_ENDPOINT;
+        len = KBD2_REPORT_SIZE;
+    } else
 #endif
     {
-        if (usb_keyboard_protocol)
-            result = send_report(report, KBD_ENDPOINT, 0, KBD_SIZE);
-        else
-            result = send_report(report, KBD_ENDPOINT, 0, 6);
+        endpoint = KBD_ENDPOINT;
+        len = usb_keyboard_protocol ? KBD_SIZE : 6;
+    }
+
+    // report is sent only when changed, idle timeout repeats it
+    if (endpoint == report_prev_endpoint && !memcmp(&report_prev, report, len))
+        return 0;
+
+    // keyboard runs during enumeration, keep latest state until configured
+    if (!usb_configured()) {
+        uint8_t intr_state = SREG;
+        cli();
+        report_prev = *report;
+        report_prev_endpoint = endpoint;
+        report_prev_len = len;
+        usb_keyboard_unsent = 1;
+        SREG = intr_state;
+        return 0;
     }
 
+    result = send_report(report, endpoint, 0, len);
     if (result) return result;
+    latency_mark(LATENCY_USB);
+
+    uint8_t intr_state = SREG;
+    cli();
+    usb_keyboard_unsent = 0;
+    report_prev = *report;
+    report_prev_endpoint = endpoint;
+    report_prev_len = len;
     usb_keyboard_idle_count = 0;
+    SREG = intr_state;
+
     usb_keyboard_print_report(report);
     return 0;
 }
 
+// called from SOF interrupt when idle period expires
+int8_t usb_keyboard_resend_report(void)
+{
+    UENUM = report_prev_endpoint;
+    if (!(UEINTX & (1<<RWAL))) return -1;
+    for (uint8_t i = 0; i < report_prev_len; i++) {
+        UEDATX = report_prev.raw[i];
+    }
+    UEINTX = 0x3A;
+    return 0;
+}
+
 void usb_keyboard_print_report(report_keyboard_t *report)
 {
-    if (!debug_keyboard) return;
+    if (!log_active(HOST, LOG_LEVEL_DEBUG)) return;
     print("keys: ");
     for (int i = 0; i < REPORT_KEYS; i++) { phex(report->keys[i]); print(" "); }
     print(" mods: "); phex(report->mods); print("\n");
@@ -34,9 +34,11 @@ extern uint8_t usb_keyboard_protocol;
 extern uint8_t usb_keyboard_idle_config;
 extern uint8_t usb_keyboard_idle_count;
 extern volatile uint8_t usb_keyboard_leds;
+extern volatile uint8_t usb_keyboard_unsent;
 
 
 int8_t usb_keyboard_send_report(report_keyboard_t *report);
+int8_t usb_keyboard_resend_report(void);
 void usb_keyboard_print_report(report_keyboard_t *report);
 
 #endif
@@ -71,7 +71,7 @@ int8_t usb_mouse_send(int8_t x, int8_t y, int8_t wheel_v, int8_t wheel_h, uint8_
 }
 
 void usb_mouse_print(int8_t x, int8_t y, int8_t wheel_v, int8_t wheel_h, uint8_t buttons) {
-    if (!debug_mouse) return;
+    if (!log_active(MOUSE, LOG_LEVEL_DEBUG)) return;
     print("usb_mouse[btn|x y v h]: ");
     phex(buttons); print("|");
     phex(x); print(" ");
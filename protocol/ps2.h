@@ -87,6 +87,8 @@ extern uint8_t ps2_error;
 
 void ps2_host_init(void);
 uint8_t ps2_host_send(uint8_t data);
+/* queue command, its ACK is consumed by ps2_host_recv() */
+bool ps2_host_send_async(uint8_t data);
 uint8_t ps2_host_recv_response(void);
 uint8_t ps2_host_recv(void);
 void ps2_host_set_led(uint8_t usb_led);
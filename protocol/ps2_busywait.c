@@ -177,6 +177,13 @@ ERROR:
     return 0;
 }
 
+/* no background transmission with busywait, sent at once */
+bool ps2_host_send_async(uint8_t data)
+{
+    ps2_host_send(data);
+    return true;
+}
+
 /* send LED state to keyboard */
 void ps2_host_set_led(uint8_t led)
 {
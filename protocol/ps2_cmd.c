@@ -0,0 +1,117 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ps2.h"
+#include "ps2_cmd.h"
+#include "print.h"
+#include "timer.h"
+#include "ringbuf.h"
+
+
+/* command may take 25ms/20ms at most([5]p.46, [3]p.21) */
+#define RESPONSE_TIMEOUT 25
+#define CMD_RETRY       3
+
+volatile bool ps2_cmd_waiting = false;
+volatile uint8_t ps2_cmd_response = 0;
+
+RINGBUF_DEFINE(cmdq, 8);
+static enum {
+    CMD_IDLE,
+    CMD_SEND,
+    CMD_RESPONSE,
+} cmd_state = CMD_IDLE;
+static uint8_t cmd_data = 0;
+static uint8_t cmd_retry = 0;
+static uint16_t cmd_time = 0;
+
+static void cmd_fail(void)
+{
+    /* arguments of failed command are meaningless to device */
+    cmdq_clear();
+    ps2_cmd_waiting = false;
+    cmd_state = CMD_IDLE;
+    print("ps2 cmd: "); phex(cmd_data); print(" failed\n");
+}
+
+static void cmd_send(void)
+{
+    ps2_cmd_response = 0;
+    ps2_cmd_waiting = true;
+    ps2_cmd_tx_start(cmd_data);
+    cmd_state = CMD_SEND;
+}
+
+void ps2_cmd_task(void)
+{
+    switch (cmd_state) {
+        case CMD_IDLE:
+            if (!cmdq_has_data()) break;
+            cmd_data = cmdq_get();
+            cmd_retry = CMD_RETRY;
+            cmd_send();
+            // fall through
+        case CMD_SEND:
+            switch (ps2_cmd_tx_state()) {
+                case PS2_TX_BUSY:
+                    return;
+                case PS2_TX_FAIL:
+                    cmd_fail();
+                    return;
+            }
+            cmd_time = timer_read();
+            cmd_state = CMD_RESPONSE;
+            break;
+        case CMD_RESPONSE:
+            if (ps2_cmd_waiting) {
+                if (timer_elapsed(cmd_time) > RESPONSE_TIMEOUT) cmd_fail();
+            } else if (ps2_cmd_response == PS2_ACK) {
+                cmd_state = CMD_IDLE;
+            } else if (cmd_retry--) {
+                cmd_send();
+            } else {
+                cmd_fail();
+            }
+            break;
+    }
+}
+
+void ps2_cmd_flush(void)
+{
+    while (cmd_state != CMD_IDLE || cmdq_has_data()) {
+        ps2_cmd_task();
+    }
+}
+
+bool ps2_host_send_async(uint8_t data)
+{
+    bool queued = cmdq_put(data);
+    ps2_cmd_task();
+    return queued;
+}
+
+/* send LED state to keyboard */
+void ps2_host_set_led(uint8_t led)
+{
+    // command and its argument are queued together or not at all
+    if (cmdq_free() < 2) {
+        print("cmdq: full\n");
+        return;
+    }
+    ps2_host_send_async(PS2_SET_LED);
+    ps2_host_send_async(led);
+}
@@ -0,0 +1,60 @@
+/*
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PS2_CMD_H
+#define PS2_CMD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ps2.h"
+
+
+/*
+ * PS/2 command queue shared by interrupt and USART drivers
+ *
+ * Commands are sent in background by ps2_cmd_task(), which driver calls from
+ * ps2_host_recv(). ACK/RESEND of queued command is taken by receive ISR with
+ * ps2_cmd_rx() before it goes to receive buffer, so scan codes received
+ * ahead of the response don't hold it up.
+ */
+enum {
+    PS2_TX_BUSY,
+    PS2_TX_DONE,
+    PS2_TX_FAIL,
+};
+
+/* driver hooks: start host to device frame and poll its result */
+void ps2_cmd_tx_start(uint8_t data);
+uint8_t ps2_cmd_tx_state(void);
+
+void ps2_cmd_task(void);
+/* send queued commands and wait for their responses */
+void ps2_cmd_flush(void);
+
+extern volatile bool ps2_cmd_waiting;
+extern volatile uint8_t ps2_cmd_response;
+
+/* called from receive ISR, returns true when data is response to command */
+static inline bool ps2_cmd_rx(uint8_t data)
+{
+    if (ps2_cmd_waiting && (data == PS2_ACK || data == PS2_RESEND)) {
+        ps2_cmd_response = data;
+        ps2_cmd_waiting = false;
+        return true;
+    }
+    return false;
+}
+
+#endif
@@ -44,40 +44,49 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <util/delay.h>
 #include "ps2.h"
 #include "print.h"
-
-
-#define WAIT(stat, us, err) do { \
-    if (!wait_##stat(us)) { \
-        ps2_error = err; \
-        goto ERROR; \
-    } \
-} while (0)
+#include "timer.h"
+#include "ringbuf.h"
+#include "ps2_cmd.h"
 
 
 uint8_t ps2_error = PS2_ERR_NONE;
 
 
-static inline uint8_t pbuf_dequeue(void);
-static inline void pbuf_enqueue(uint8_t data);
-static inline bool pbuf_has_data(void);
-static inline void pbuf_clear(void);
-
+/* scan codes from keyboard */
+RINGBUF_DEFINE(pbuf, 32);
+static uint8_t pbuf_overflow = 0;
 
-void ps2_host_init(void)
-{
-    idle();
-    PS2_INT_INIT();
-    PS2_INT_ON();
-    // POR(150-2000ms) plus BAT(300-500ms) may take 2.5sec([3]p.20)
-    //_delay_ms(2500);
-}
 
-uint8_t ps2_host_send(uint8_t data)
+/*
+ * Host to device frame is clocked out by ISR: data line is changed on each
+ * falling edge of clock generated by device, ACK is sampled after stop bit.
+ */
+enum {
+    TX_NONE,
+    TX_BIT0, TX_BIT1, TX_BIT2, TX_BIT3, TX_BIT4, TX_BIT5, TX_BIT6, TX_BIT7,
+    TX_PARITY,
+    TX_STOP,
+    TX_ACK,
+    TX_DONE,
+    TX_FAIL,
+};
+static volatile uint8_t tx_state = TX_NONE;
+static uint8_t tx_data = 0;
+static uint8_t tx_parity = 1;
+static uint16_t tx_time = 0;
+
+/* device should start clock in 15ms and finish frame in 2ms [4]p.13 */
+#define TX_TIMEOUT      20
+/* command may take 25ms/20ms at most([5]p.46, [3]p.21) */
+#define RESPONSE_TIMEOUT 25
+
+
+static void tx_start(uint8_t data)
 {
-    bool parity = true;
-    ps2_error = PS2_ERR_NONE;
-
     PS2_INT_OFF();
+    tx_data = data;
+    tx_parity = 1;
+    tx_state = TX_BIT0;
 
     /* terminate a transmission if we have */
     inhibit();
@@ -86,46 +95,101 @@ uint8_t ps2_host_send(uint8_t data)
     /* 'Request to Send' and Start bit */
     data_lo();
     clock_hi();
-    WAIT(clock_lo, 10000, 10);   // 10ms [5]p.50
+    tx_time = timer_read();
+    PS2_INT_ON();
+}
 
-    /* Data bit[2-9] */
-    for (uint8_t i = 0; i < 8; i++) {
-        _delay_us(15);
-        if (data&(1<<i)) {
-            parity = !parity;
+/* returns true while frame is on the wire */
+static bool tx_busy(void)
+{
+    uint8_t state = tx_state;
+    if (state == TX_NONE || state >= TX_DONE) return false;
+    if (timer_elapsed(tx_time) < TX_TIMEOUT) return true;
+
+    PS2_INT_OFF();
+    state = tx_state;
+    if (state < TX_DONE) {
+        // 10: no clock from device
+        ps2_error = (state == TX_BIT0 ? 10 : state);
+        tx_state = TX_FAIL;
+        idle();
+    }
+    PS2_INT_ON();
+    return false;
+}
+
+static void tx_clock(void)
+{
+    uint8_t state = tx_state;
+    switch (state) {
+        case TX_BIT0:
+        case TX_BIT1:
+        case TX_BIT2:
+        case TX_BIT3:
+        case TX_BIT4:
+        case TX_BIT5:
+        case TX_BIT6:
+        case TX_BIT7:
+            if (tx_data & 1) {
+                tx_parity++;
+                data_hi();
+            } else {
+                data_lo();
+            }
+            tx_data >>= 1;
+            break;
+        case TX_PARITY:
+            if (tx_parity & 1) { data_hi(); } else { data_lo(); }
+            break;
+        case TX_STOP:
             data_hi();
-        } else {
-            data_lo();
-        }
-        WAIT(clock_hi, 50, 2);
-        WAIT(clock_lo, 50, 3);
+            break;
+        case TX_ACK:
+            if (data_in()) {
+                ps2_error = TX_ACK;
+                tx_state = TX_FAIL;
+                return;
+            }
+            break;
     }
+    tx_state = state + 1;
+}
 
-    /* Parity bit */
-    _delay_us(15);
-    if (parity) { data_hi(); } else { data_lo(); }
-    WAIT(clock_hi, 50, 4);
-    WAIT(clock_lo, 50, 5);
 
-    /* Stop bit */
-    _delay_us(15);
-    data_hi();
+/* command queue hooks, see ps2_cmd.h */
+void ps2_cmd_tx_start(uint8_t data)
+{
+    tx_start(data);
+}
 
-    /* Ack */
-    WAIT(data_lo, 50, 6);
-    WAIT(clock_lo, 50, 7);
+uint8_t ps2_cmd_tx_state(void)
+{
+    if (tx_busy()) return PS2_TX_BUSY;
+    return (tx_state == TX_DONE ? PS2_TX_DONE : PS2_TX_FAIL);
+}
 
-    /* wait for idle state */
-    WAIT(clock_hi, 50, 8);
-    WAIT(data_hi, 50, 9);
 
+void ps2_host_init(void)
+{
     idle();
+    PS2_INT_INIT();
     PS2_INT_ON();
+    // POR(150-2000ms) plus BAT(300-500ms) may take 2.5sec([3]p.20)
+    //_delay_ms(2500);
+}
+
+uint8_t ps2_host_send(uint8_t data)
+{
+    /* queued commands go first */
+    ps2_cmd_flush();
+
+    ps2_error = PS2_ERR_NONE;
+    tx_start(data);
+    while (tx_busy()) ;
+    if (tx_state != TX_DONE) {
+        return 0;
+    }
     return ps2_host_recv_response();
-ERROR:
-    idle();
-    PS2_INT_ON();
-    return 0;
 }
 
 uint8_t ps2_host_recv_response(void)
@@ -135,15 +199,20 @@ uint8_t ps2_host_recv_response(void)
     while (retry-- && !pbuf_has_data()) {
         _delay_ms(1);
     }
-    return pbuf_dequeue();
+    return pbuf_has_data() ? pbuf_get() : 0;
 }
 
 /* get data received by interrupt */
 uint8_t ps2_host_recv(void)
 {
+    ps2_cmd_task();
+    if (pbuf.overflow != pbuf_overflow) {
+        pbuf_overflow = pbuf.overflow;
+        print("pbuf: full\n");
+    }
     if (pbuf_has_data()) {
         ps2_error = PS2_ERR_NONE;
-        return pbuf_dequeue();
+        return pbuf_get();
     } else {
         ps2_error = PS2_ERR_NODATA;
         return 0;
@@ -169,6 +238,11 @@ ISR(PS2_INT_VECT)
         goto RETURN;
     }
 
+    if (tx_state >= TX_BIT0 && tx_state <= TX_ACK) {
+        tx_clock();
+        goto RETURN;
+    }
+
     state++;
     switch (state) {
         case START:
@@ -201,7 +275,8 @@ ISR(PS2_INT_VECT)
         case STOP:
             if (!data_in())
                 goto ERROR;
-            pbuf_enqueue(data);
+            if (!ps2_cmd_rx(data))
+                pbuf_put(data);
             goto DONE;
             break;
         default:
@@ -217,62 +292,3 @@ DONE:
 RETURN:
     return;
 }
-
-/* send LED state to keyboard */
-void ps2_host_set_led(uint8_t led)
-{
-    ps2_host_send(0xED);
-    ps2_host_send(led);
-}
-
-
-/*--------------------------------------------------------------------
- * Ring buffer to store scan codes from keyboard
- *------------------------------------------------------------------*/
-#define PBUF_SIZE 32
-static uint8_t pbuf[PBUF_SIZE];
-static uint8_t pbuf_head = 0;
-static uint8_t pbuf_tail = 0;
-static inline void pbuf_enqueue(uint8_t data)
-{
-    uint8_t sreg = SREG;
-    cli();
-    uint8_t next = (pbuf_head + 1) % PBUF_SIZE;
-    if (next != pbuf_tail) {
-        pbuf[pbuf_head] = data;
-        pbuf_head = next;
-    } else {
-        print("pbuf: full\n");
-    }
-    SREG = sreg;
-}
-static inline uint8_t pbuf_dequeue(void)
-{
-    uint8_t val = 0;
-
-    uint8_t sreg = SREG;
-    cli();
-    if (pbuf_head != pbuf_tail) {
-        val = pbuf[pbuf_tail];
-        pbuf_tail = (pbuf_tail + 1) % PBUF_SIZE;
-    }
-    SREG = sreg;
-
-    return val;
-}
-static inline bool pbuf_has_data(void)
-{
-    uint8_t sreg = SREG;
-    cli();
-    bool has_data = (pbuf_head != pbuf_tail);
-    SREG = sreg;
-    return has_data;
-}
-static inline void pbuf_clear(void)
-{
-    uint8_t sreg = SREG;
-    cli();
-    pbuf_head = pbuf_tail = 0;
-    SREG = sreg;
-}
-
@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdbool.h>
 #include<avr/io.h>
+#include<avr/pgmspace.h>
 #include<util/delay.h>
 #include "ps2.h"
 #include "ps2_mouse.h"
@@ -28,12 +29,91 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 
 static report_mouse_t mouse_report = {};
+static uint8_t mouse_id = PS2_MOUSE_ID_STANDARD;
 
 
+static void process_packet(uint8_t ext);
 static void print_usb_data(void);
 
 
-/* supports only 3 button mouse at this time */
+/*
+ * Pointer pipeline
+ *
+ * Movement is scaled by sensitivity and gain of acceleration curve in Q8 and
+ * added to accumulators. Whole counts are taken out for report and fraction is
+ * carried to next packet, as well as excess over HID range which is sent in
+ * following reports instead of being clipped.
+ */
+uint8_t pm_sensitivity = PS2_MOUSE_SENSITIVITY;
+uint8_t pm_accel = PS2_MOUSE_ACCEL;
+
+/* gain in 1/16 by speed: (|x| + |y|)/4 counts per packet */
+static const uint8_t PROGMEM accel_curve[16] = {
+    16, 16, 17, 18, 20, 22, 24, 26, 28, 30, 32, 34, 36, 38, 40, 42
+};
+
+#define CARRY_MAX   ((int32_t)PS2_MOUSE_CARRY_MAX << 8)
+static int32_t acc_x = 0;
+static int32_t acc_y = 0;
+
+static int32_t pointer_clamp(int32_t acc)
+{
+    if (acc > CARRY_MAX) return CARRY_MAX;
+    if (acc < -CARRY_MAX) return -CARRY_MAX;
+    return acc;
+}
+
+static void pointer_add(int16_t x, int16_t y)
+{
+    uint16_t speed = ((x < 0 ? -x : x) + (y < 0 ? -y : y)) >> 2;
+    uint8_t curve = pgm_read_byte(&accel_curve[speed < 15 ? speed : 15]);
+    uint16_t gain = 16 + (((curve - 16) * pm_accel) >> 4);
+    int32_t scale = (int32_t)pm_sensitivity * gain;
+    acc_x = pointer_clamp(acc_x + (int32_t)x * scale);
+    acc_y = pointer_clamp(acc_y + (int32_t)y * scale);
+}
+
+static int8_t pointer_take(int32_t *acc)
+{
+    int16_t count = *acc / 256;
+    if (count > 127) count = 127;
+    if (count < -127) count = -127;
+    *acc -= (int32_t)count * 256;
+    return count;
+}
+
+static bool pointer_pending(void)
+{
+    return acc_x >= 256 || acc_x <= -256 || acc_y >= 256 || acc_y <= -256;
+}
+
+static void pointer_clear(void)
+{
+    acc_x = 0;
+    acc_y = 0;
+}
+
+
+#ifndef PS2_MOUSE_NO_EXTENSION
+static uint8_t set_sample_rate(uint8_t rate)
+{
+    uint8_t rcv = ps2_host_send(0xF3);
+    if (rcv == PS2_ACK) rcv = ps2_host_send(rate);
+    return rcv;
+}
+
+/* magic sequence of sample rates unlocks extension, returns new Device ID */
+static uint8_t knock(uint8_t r0, uint8_t r1, uint8_t r2)
+{
+    set_sample_rate(r0);
+    set_sample_rate(r1);
+    set_sample_rate(r2);
+    if (ps2_host_send(0xF2) != PS2_ACK) return PS2_MOUSE_ID_STANDARD;
+    return ps2_host_recv_response();
+}
+#endif
+
+/* supports 3 button mouse, IntelliMouse wheel and 5 button Explorer */
 uint8_t ps2_mouse_init(void) {
     uint8_t rcv;
 
@@ -56,10 +136,36 @@ uint8_t ps2_mouse_init(void) {
     print("ps2_mouse_init: read DevID: ");
     phex(rcv); phex(ps2_error); print("\n");
 
+#ifndef PS2_MOUSE_NO_EXTENSION
+    // IntelliMouse: 200, 100, 80 and Explorer: 200, 200, 80
+    mouse_id = knock(200, 100, 80);
+    if (mouse_id == PS2_MOUSE_ID_INTELLIMOUSE) {
+        mouse_id = knock(200, 200, 80);
+        if (mouse_id != PS2_MOUSE_ID_EXPLORER) mouse_id = PS2_MOUSE_ID_INTELLIMOUSE;
+    } else {
+        mouse_id = PS2_MOUSE_ID_STANDARD;
+    }
+    print("ps2_mouse_init: extension ID: ");
+    phex(mouse_id); print("\n");
+#endif
+
+#ifdef PS2_MOUSE_USE_REMOTE_MODE
     // send Set Remote mode
     rcv = ps2_host_send(0xF0);
     print("ps2_mouse_init: send 0xF0: ");
     phex(rcv); phex(ps2_error); print("\n");
+#else
+    // send Set Sample Rate
+    rcv = ps2_host_send(0xF3);
+    if (rcv == PS2_ACK) rcv = ps2_host_send(PS2_MOUSE_SAMPLE_RATE);
+    print("ps2_mouse_init: send 0xF3: ");
+    phex(rcv); phex(ps2_error); print("\n");
+
+    // send Enable Data Reporting, stream mode is default after reset
+    rcv = ps2_host_send(0xF4);
+    print("ps2_mouse_init: send 0xF4: ");
+    phex(rcv); phex(ps2_error); print("\n");
+#endif
 
     return 0;
 }
@@ -68,12 +174,9 @@ uint8_t ps2_mouse_init(void) {
 #define Y_IS_NEG  (mouse_report.buttons & (1<<PS2_MOUSE_Y_SIGN))
 #define X_IS_OVF  (mouse_report.buttons & (1<<PS2_MOUSE_X_OVFLW))
 #define Y_IS_OVF  (mouse_report.buttons & (1<<PS2_MOUSE_Y_OVFLW))
+#ifdef PS2_MOUSE_USE_REMOTE_MODE
 void ps2_mouse_task(void)
 {
-    enum { SCROLL_NONE, SCROLL_BTN, SCROLL_SENT };
-    static uint8_t scroll_state = SCROLL_NONE;
-    static uint8_t buttons_prev = 0;
-
     /* receives packet from mouse */
     uint8_t rcv;
     rcv = ps2_host_send(PS2_MOUSE_READ_DATA);
@@ -82,22 +185,97 @@ void ps2_mouse_task(void)
         mouse_report.x = ps2_host_recv_response();
         mouse_report.y = ps2_host_recv_response();
     } else {
-        if (!debug_mouse) print("ps2_mouse: fail to get mouse packet\n");
+        log_warn(MOUSE, "ps2_mouse: fail to get mouse packet\n");
         return;
     }
+    process_packet(mouse_id ? ps2_host_recv_response() : 0);
+}
+#else
+/* packets streamed by mouse are buffered by receive interrupt */
+void ps2_mouse_task(void)
+{
+    static uint8_t packet[PS2_MOUSE_PACKET_SIZE_EXT];
+    static uint8_t index = 0;
+    // buttons and 4th byte of last complete packet, packet[] may hold a partial one
+    static uint8_t last_buttons = 0;
+    static uint8_t last_ext = 0;
+    static uint16_t last_time = 0;
+    bool received = false;
+
+    // drop partial packet when rest of it doesn't come
+    if (index && timer_elapsed(last_time) > PS2_MOUSE_PACKET_TIMEOUT) {
+        log_warn(MOUSE, "ps2_mouse: partial packet\n");
+        index = 0;
+    }
+
+    while (true) {
+        uint8_t rcv = ps2_host_recv();
+        if (ps2_error) break;
+        last_time = timer_read();
+
+        // first byte always has bit 3 set, skip until sync
+        if (index == 0 && !(rcv & (1<<PS2_MOUSE_ALWAYS_1))) {
+            continue;
+        }
+        packet[index++] = rcv;
+        if (index < (mouse_id ? PS2_MOUSE_PACKET_SIZE_EXT : PS2_MOUSE_PACKET_SIZE)) {
+            continue;
+        }
+        index = 0;
+
+        last_buttons = packet[0] & (PS2_MOUSE_BTN_MASK | (1<<PS2_MOUSE_ALWAYS_1));
+        last_ext = (mouse_id == PS2_MOUSE_ID_EXPLORER ? packet[3] & 0xF0 : 0);
+
+        mouse_report.buttons = packet[0];
+        mouse_report.x = packet[1];
+        mouse_report.y = packet[2];
+        process_packet(mouse_id ? packet[3] : 0);
+        received = true;
+    }
+
+    // send rest of carried move with button state of last packet
+    if (!received && pointer_pending()) {
+        mouse_report.buttons = last_buttons;
+        mouse_report.x = 0;
+        mouse_report.y = 0;
+        process_packet(last_ext);
+    }
+}
+#endif
+
+/* ext: 4th byte of IntelliMouse/Explorer packet */
+static void process_packet(uint8_t ext)
+{
+    enum { SCROLL_NONE, SCROLL_BTN, SCROLL_SENT };
+    static uint8_t scroll_state = SCROLL_NONE;
+    static uint8_t buttons_prev = 0;
+
+    int8_t wheel = 0;
+    uint8_t buttons = mouse_report.buttons & PS2_MOUSE_BTN_MASK;
+    switch (mouse_id) {
+        case PS2_MOUSE_ID_INTELLIMOUSE:
+            wheel = ext;
+            break;
+        case PS2_MOUSE_ID_EXPLORER:
+            // 4-bit two's complement
+            wheel = (ext & 0x08) ? (ext | 0xF0) : (ext & 0x0F);
+            if (ext & (1<<PS2_MOUSE_EXT_BTN4)) buttons |= MOUSE_BTN4;
+            if (ext & (1<<PS2_MOUSE_EXT_BTN5)) buttons |= MOUSE_BTN5;
+            break;
+    }
 
     /* if mouse moves or buttons state changes */
-    if (mouse_report.x || mouse_report.y ||
-            ((mouse_report.buttons ^ buttons_prev) & PS2_MOUSE_BTN_MASK)) {
+    if (mouse_report.x || mouse_report.y || wheel || buttons != buttons_prev || pointer_pending()) {
 
 #ifdef PS2_MOUSE_DEBUG
         print("ps2_mouse raw: [");
         phex(mouse_report.buttons); print("|");
         print_hex8((uint8_t)mouse_report.x); print(" ");
-        print_hex8((uint8_t)mouse_report.y); print("]\n");
+        print_hex8((uint8_t)mouse_report.y); print(" ");
+        print_hex8(ext); print("]\n");
 #endif
 
-        buttons_prev = mouse_report.buttons;
+        buttons_prev = buttons;
 
         // PS/2 mouse data is '9-bit integer'(-256 to 255) which is comprised of sign-bit and 8-bit value.
         // bit: 8    7 ... 0
@@ -105,57 +283,64 @@ void ps2_mouse_task(void)
         //
         // Meanwhile USB HID mouse indicates 8bit data(-127 to 127), note that -128 is not used.
         //
-        // This converts PS/2 data into HID value. Use only -127-127 out of PS/2 9-bit.
-        mouse_report.x = X_IS_NEG ?
-                          ((!X_IS_OVF && -127 <= mouse_report.x && mouse_report.x <= -1) ?  mouse_report.x : -127) :
-                          ((!X_IS_OVF && 0 <= mouse_report.x && mouse_report.x <= 127) ? mouse_report.x : 127);
-        mouse_report.y = Y_IS_NEG ?
-                          ((!Y_IS_OVF && -127 <= mouse_report.y && mouse_report.y <= -1) ?  mouse_report.y : -127) :
-                          ((!Y_IS_OVF && 0 <= mouse_report.y && mouse_report.y <= 127) ? mouse_report.y : 127);
+        // This converts PS/2 data into 9-bit value, saturated on overflow, and
+        // then into HID value through pointer pipeline.
+        int16_t x = X_IS_OVF ? (X_IS_NEG ? -255 : 255) :
+                               (int16_t)(uint8_t)mouse_report.x - (X_IS_NEG ? 256 : 0);
+        int16_t y = Y_IS_OVF ? (Y_IS_NEG ? -255 : 255) :
+                               (int16_t)(uint8_t)mouse_report.y - (Y_IS_NEG ? 256 : 0);
+        pointer_add(x, y);
+        mouse_report.x = pointer_take(&acc_x);
+        mouse_report.y = pointer_take(&acc_y);
 
         // remove sign and overflow flags
-        mouse_report.buttons &= PS2_MOUSE_BTN_MASK;
+        mouse_report.buttons = buttons;
 
-        // invert coordinate of y to conform to USB HID mouse
+        // invert coordinate of y and wheel to conform to USB HID mouse
         mouse_report.y = -mouse_report.y;
+        mouse_report.v = -wheel;
 
 
 #if PS2_MOUSE_SCROLL_BTN_MASK
-        static uint16_t scroll_button_time = 0;
-        if ((mouse_report.buttons & (PS2_MOUSE_SCROLL_BTN_MASK)) == (PS2_MOUSE_SCROLL_BTN_MASK)) {
-            if (scroll_state == SCROLL_NONE) {
-                scroll_button_time = timer_read();
-                scroll_state = SCROLL_BTN;
-            }
-
-            // doesn't send Scroll Button
-            //mouse_report.buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
-
-            if (mouse_report.x || mouse_report.y) {
-                scroll_state = SCROLL_SENT;
-
-                mouse_report.v = -mouse_report.y/(PS2_MOUSE_SCROLL_DIVISOR_V);
-                mouse_report.h =  mouse_report.x/(PS2_MOUSE_SCROLL_DIVISOR_H);
-                mouse_report.x = 0;
-                mouse_report.y = 0;
-                //host_mouse_send(&mouse_report);
+        // emulate wheel with button only on mouse without one
+        if (mouse_id == PS2_MOUSE_ID_STANDARD) {
+            static uint16_t scroll_button_time = 0;
+            if ((mouse_report.buttons & (PS2_MOUSE_SCROLL_BTN_MASK)) == (PS2_MOUSE_SCROLL_BTN_MASK)) {
+                if (scroll_state == SCROLL_NONE) {
+                    scroll_button_time = timer_read();
+                    scroll_state = SCROLL_BTN;
+                }
+
+                // doesn't send Scroll Button
+                //mouse_report.buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
+
+                if (mouse_report.x || mouse_report.y) {
+                    scroll_state = SCROLL_SENT;
+                    pointer_clear();
+
+                    mouse_report.v = -mouse_report.y/(PS2_MOUSE_SCROLL_DIVISOR_V);
+                    mouse_report.h =  mouse_report.x/(PS2_MOUSE_SCROLL_DIVISOR_H);
+                    mouse_report.x = 0;
+                    mouse_report.y = 0;
+                    //host_mouse_send(&mouse_report);
+                }
             }
-        }
-        else if ((mouse_report.buttons & (PS2_MOUSE_SCROLL_BTN_MASK)) == 0) {
+            else if ((mouse_report.buttons & (PS2_MOUSE_SCROLL_BTN_MASK)) == 0) {
 #if PS2_MOUSE_SCROLL_BTN_SEND
-            if (scroll_state == SCROLL_BTN &&
-                    TIMER_DIFF_16(timer_read(), scroll_button_time) < PS2_MOUSE_SCROLL_BTN_SEND) {
-                // send Scroll Button(down and up at once) when not scrolled
-                mouse_report.buttons |= (PS2_MOUSE_SCROLL_BTN_MASK);
-                host_mouse_send(&mouse_report);
-                _delay_ms(100);
-                mouse_report.buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
-            }
+                if (scroll_state == SCROLL_BTN &&
+                        TIMER_DIFF_16(timer_read(), scroll_button_time) < PS2_MOUSE_SCROLL_BTN_SEND) {
+                    // send Scroll Button(down and up at once) when not scrolled
+                    mouse_report.buttons |= (PS2_MOUSE_SCROLL_BTN_MASK);
+                    host_mouse_send(&mouse_report);
+                    _delay_ms(100);
+                    mouse_report.buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
+                }
 #endif
-            scroll_state = SCROLL_NONE;
+                scroll_state = SCROLL_NONE;
+            }
+            // doesn't send Scroll Button
+            mouse_report.buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
         }
-        // doesn't send Scroll Button
-        mouse_report.buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
 #endif
 
 
@@ -172,7 +357,7 @@ void ps2_mouse_task(void)
 
 static void print_usb_data(void)
 {
-    if (!debug_mouse) return;
+    if (!log_active(MOUSE, LOG_LEVEL_DEBUG)) return;
     print("ps2_mouse usb: [");
     phex(mouse_report.buttons); print("|");
     print_hex8((uint8_t)mouse_report.x); print(" ");
@@ -204,7 +389,9 @@ static void print_usb_data(void)
  * Stream Mode: devices sends the data when it changs its state
  * Remote Mode: host polls the data periodically
  *
- * This code uses Remote Mode and polls the data with Read Data(0xEB).
+ * This code uses Stream Mode and packets are received by interrupt. With
+ * PS2_MOUSE_USE_REMOTE_MODE(default with busywait) it uses Remote Mode and
+ * polls the data with Read Data(0xEB) instead.
  *
  * Data format:
  * byte|7       6       5       4       3       2       1       0
@@ -212,4 +399,9 @@ static void print_usb_data(void)
  *    0|Yovflw  Xovflw  Ysign   Xsign   1       Middle  Right   Left
  *    1|                    X movement
  *    2|                    Y movement
+ *    3|                    Z movement                  (IntelliMouse, ID 3)
+ *    3|0       0       Btn5    Btn4    Z3      Z2      Z1      Z0(Explorer, ID 4)
+ *
+ * Extension is enabled by setting sample rate 200, 100, 80(IntelliMouse) and
+ * then 200, 200, 80(Explorer) and is confirmed with Get Device ID.
  */
@@ -34,14 +34,63 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PS2_MOUSE_BTN_LEFT      0
 #define PS2_MOUSE_BTN_RIGHT     1
 #define PS2_MOUSE_BTN_MIDDLE    2
+#define PS2_MOUSE_ALWAYS_1      3
 #define PS2_MOUSE_X_SIGN        4
 #define PS2_MOUSE_Y_SIGN        5
 #define PS2_MOUSE_X_OVFLW       6
 #define PS2_MOUSE_Y_OVFLW       7
 
+#define PS2_MOUSE_PACKET_SIZE   3
 
 /*
- * Scroll by mouse move with pressing button
+ * 4th byte of Explorer(ID 4), IntelliMouse(ID 3) has only Z movement
+ *    3|0       0       Btn5    Btn4    Z3      Z2      Z1      Z0
+ */
+#define PS2_MOUSE_EXT_BTN4      4
+#define PS2_MOUSE_EXT_BTN5      5
+#define PS2_MOUSE_PACKET_SIZE_EXT   4
+
+#define PS2_MOUSE_ID_STANDARD       0x00
+#define PS2_MOUSE_ID_INTELLIMOUSE   0x03
+#define PS2_MOUSE_ID_EXPLORER       0x04
+
+
+/*
+ * Stream mode needs packets received by interrupt, busywait polls mouse
+ */
+#if defined(PS2_USE_BUSYWAIT) && !defined(PS2_MOUSE_USE_REMOTE_MODE)
+#define PS2_MOUSE_USE_REMOTE_MODE
+#endif
+/* reports per second in stream mode: 10, 20, 40, 60, 80, 100 or 200 */
+#ifndef PS2_MOUSE_SAMPLE_RATE
+#define PS2_MOUSE_SAMPLE_RATE           100
+#endif
+/* drop partial packet when rest of it doesn't arrive in this time(ms) */
+#ifndef PS2_MOUSE_PACKET_TIMEOUT
+#define PS2_MOUSE_PACKET_TIMEOUT        20
+#endif
+
+
+/*
+ * Pointer pipeline: move = count * sensitivity/16 * (acceleration gain)
+ */
+/* sensitivity in 1/16: 16 is 1.0 */
+#ifndef PS2_MOUSE_SENSITIVITY
+#define PS2_MOUSE_SENSITIVITY           16
+#endif
+/* how much of acceleration curve is applied in 1/16: 0 is linear */
+#ifndef PS2_MOUSE_ACCEL
+#define PS2_MOUSE_ACCEL                 0
+#endif
+/* limit of move carried to following reports(counts) */
+#ifndef PS2_MOUSE_CARRY_MAX
+#define PS2_MOUSE_CARRY_MAX             1024
+#endif
+
+
+/*
+ * Scroll by mouse move with pressing button, used only when mouse has no wheel
+ * (define PS2_MOUSE_NO_EXTENSION not to probe wheel and extra buttons)
  */
 /* mouse button to start scrolling; set 0 to disable scroll */
 #ifndef PS2_MOUSE_SCROLL_BTN_MASK
@@ -60,6 +109,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 
+extern uint8_t pm_sensitivity;
+extern uint8_t pm_accel;
+
 uint8_t ps2_mouse_init(void);
 void ps2_mouse_task(void);
 
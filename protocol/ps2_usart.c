@@ -44,6 +44,9 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <util/delay.h>
 #include "ps2.h"
 #include "print.h"
+#include "timer.h"
+#include "ringbuf.h"
+#include "ps2_cmd.h"
 
 
 #define WAIT(stat, us, err) do { \
@@ -57,10 +60,9 @@ POSSIBILITY OF SUCH DAMAGE.
 uint8_t ps2_error = PS2_ERR_NONE;
 
 
-static inline uint8_t pbuf_dequeue(void);
-static inline void pbuf_enqueue(uint8_t data);
-static inline bool pbuf_has_data(void);
-static inline void pbuf_clear(void);
+/* scan codes from keyboard */
+RINGBUF_DEFINE(pbuf, 32);
+static uint8_t pbuf_overflow = 0;
 
 
 void ps2_host_init(void)
@@ -72,7 +74,8 @@ void ps2_host_init(void)
     //_delay_ms(2500);
 }
 
-uint8_t ps2_host_send(uint8_t data)
+/* bit-bang host to device frame, USART can't drive data line */
+static bool tx_frame(uint8_t data)
 {
     bool parity = true;
     ps2_error = PS2_ERR_NONE;
@@ -122,12 +125,41 @@ uint8_t ps2_host_send(uint8_t data)
     idle();
     PS2_USART_INIT();
     PS2_USART_RX_INT_ON();
-    return ps2_host_recv_response();
+    return true;
 ERROR:
     idle();
     PS2_USART_INIT();
     PS2_USART_RX_INT_ON();
-    return 0;
+    return false;
+}
+
+
+/*
+ * Command queue hooks, see ps2_cmd.h
+ *
+ * Frame is still bit-banged(about 1ms) but response is not waited for.
+ */
+static bool tx_ok = false;
+
+void ps2_cmd_tx_start(uint8_t data)
+{
+    tx_ok = tx_frame(data);
+}
+
+uint8_t ps2_cmd_tx_state(void)
+{
+    return (tx_ok ? PS2_TX_DONE : PS2_TX_FAIL);
+}
+
+uint8_t ps2_host_send(uint8_t data)
+{
+    /* queued commands go first */
+    ps2_cmd_flush();
+
+    if (!tx_frame(data)) {
+        return 0;
+    }
+    return ps2_host_recv_response();
 }
 
 uint8_t ps2_host_recv_response(void)
@@ -137,14 +169,19 @@ uint8_t ps2_host_recv_response(void)
     while (retry-- && !pbuf_has_data()) {
         _delay_ms(1);
     }
-    return pbuf_dequeue();
+    return pbuf_has_data() ? pbuf_get() : 0;
 }
 
 uint8_t ps2_host_recv(void)
 {
+    ps2_cmd_task();
+    if (pbuf.overflow != pbuf_overflow) {
+        pbuf_overflow = pbuf.overflow;
+        print("pbuf: full\n");
+    }
     if (pbuf_has_data()) {
         ps2_error = PS2_ERR_NONE;
-        return pbuf_dequeue();
+        return pbuf_get();
     } else {
         ps2_error = PS2_ERR_NODATA;
         return 0;
@@ -157,66 +194,9 @@ ISR(PS2_USART_RX_VECT)
     uint8_t error = PS2_USART_ERROR;    // USART error should be read before data
     uint8_t data = PS2_USART_RX_DATA;
     if (!error) {
-        pbuf_enqueue(data);
+        if (!ps2_cmd_rx(data))
+            pbuf_put(data);
     } else {
         xprintf("PS2 USART error: %02X data: %02X\n", error, data);
     }
 }
-
-/* send LED state to keyboard */
-void ps2_host_set_led(uint8_t led)
-{
-    ps2_host_send(0xED);
-    ps2_host_send(led);
-}
-
-
-/*--------------------------------------------------------------------
- * Ring buffer to store scan codes from keyboard
- *------------------------------------------------------------------*/
-#define PBUF_SIZE 32
-static uint8_t pbuf[PBUF_SIZE];
-static uint8_t pbuf_head = 0;
-static uint8_t pbuf_tail = 0;
-static inline void pbuf_enqueue(uint8_t data)
-{
-    uint8_t sreg = SREG;
-    cli();
-    uint8_t next = (pbuf_head + 1) % PBUF_SIZE;
-    if (next != pbuf_tail) {
-        pbuf[pbuf_head] = data;
-        pbuf_head = next;
-    } else {
-        print("pbuf: full\n");
-    }
-    SREG = sreg;
-}
-static inline uint8_t pbuf_dequeue(void)
-{
-    uint8_t val = 0;
-
-    uint8_t sreg = SREG;
-    cli();
-    if (pbuf_head != pbuf_tail) {
-        val = pbuf[pbuf_tail];
-        pbuf_tail = (pbuf_tail + 1) % PBUF_SIZE;
-    }
-    SREG = sreg;
-
-    return val;
-}
-static inline bool pbuf_has_data(void)
-{
-    uint8_t sreg = SREG;
-    cli();
-    bool has_data = (pbuf_head != pbuf_tail);
-    SREG = sreg;
-    return has_data;
-}
-static inline void pbuf_clear(void)
-{
-    uint8_t sreg = SREG;
-    cli();
-    pbuf_head = pbuf_tail = 0;
-    SREG = sreg;
-}
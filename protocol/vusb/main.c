@@ -56,10 +56,10 @@ int main(void)
     keyboard_init();
     host_set_driver(vusb_driver());
 
-    debug("initForUsbConnectivity()\n");
+    log_debug(PROTOCOL, "initForUsbConnectivity()\n");
     initForUsbConnectivity();
 
-    debug("main loop\n");
+    log_debug(PROTOCOL, "main loop\n");
     while (1) {
 #if USB_COUNT_SOF
         if (usbSofCount != 0) {
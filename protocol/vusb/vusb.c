@@ -16,13 +16,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <stdint.h>
+#include <string.h>
 #include "usbdrv.h"
 #include "usbconfig.h"
 #include "host.h"
 #include "report.h"
 #include "print.h"
 #include "debug.h"
+#include "latency.h"
 #include "host_driver.h"
+#include "timer.h"
 #include "vusb.h"
 
 
@@ -35,15 +38,29 @@ static report_keyboard_t kbuf[KBUF_SIZE];
 static uint8_t kbuf_head = 0;
 static uint8_t kbuf_tail = 0;
 
+/* last report queued, repeated on idle timeout */
+static report_keyboard_t keyboard_report_prev;
+static uint16_t keyboard_report_time = 0;
+
 
 /* transfer keyboard report from buffer */
 void vusb_transfer_keyboard(void)
 {
     if (usbInterruptIsReady()) {
-        if (kbuf_head != kbuf_tail) {
+        if (kbuf_head == kbuf_tail) {
+            // HID Idle: repeat last report every vusb_idle_rate*4ms
+            // Low speed device gets no SOF to count, so this is polled from
+            // main loop with timer and repeat is late by up to one loop pass.
+            if (vusb_idle_rate && timer_elapsed(keyboard_report_time) >= (uint16_t)vusb_idle_rate * 4) {
+                usbSetInterrupt((void *)&keyboard_report_prev, sizeof(report_keyboard_t));
+                keyboard_report_time = timer_read();
+            }
+        } else {
             usbSetInterrupt((void *)&kbuf[kbuf_tail], sizeof(report_keyboard_t));
             kbuf_tail = (kbuf_tail + 1) % KBUF_SIZE;
-            if (debug_keyboard) {
+            keyboard_report_time = timer_read();
+            latency_mark(LATENCY_USB);
+            if (log_active(HOST, LOG_LEVEL_DEBUG)) {
                 print("V-USB: kbuf["); pdec(kbuf_tail); print("->"); pdec(kbuf_head); print("](");
                 phex((kbuf_head < kbuf_tail) ? (KBUF_SIZE - kbuf_tail + kbuf_head) : (kbuf_head - kbuf_tail));
                 print(")\n");
@@ -58,7 +75,7 @@ void vusb_transfer_keyboard(void)
  *------------------------------------------------------------------*/
 static uint8_t keyboard_leds(void);
 static void send_keyboard(report_keyboard_t *report);
-static void send_mouse(report_mouse_t *report);
+static bool send_mouse(report_mouse_t *report);
 static void send_system(uint16_t data);
 static void send_consumer(uint16_t data);
 
@@ -81,12 +98,16 @@ static uint8_t keyboard_leds(void) {
 
 static void send_keyboard(report_keyboard_t *report)
 {
+    // report is sent only when changed
+    if (!memcmp(&keyboard_report_prev, report, sizeof(report_keyboard_t))) return;
+
     uint8_t next = (kbuf_head + 1) % KBUF_SIZE;
     if (next != kbuf_tail) {
         kbuf[kbuf_head] = *report;
         kbuf_head = next;
+        keyboard_report_prev = *report;
     } else {
-        debug("kbuf: full\n");
+        log_warn(HOST, "kbuf: full\n");
     }
 
     // NOTE: send key strokes of Macro
@@ -100,15 +121,16 @@ typedef struct {
     report_mouse_t report;
 } __attribute__ ((packed)) vusb_mouse_report_t;
 
-static void send_mouse(report_mouse_t *report)
+static bool send_mouse(report_mouse_t *report)
 {
     vusb_mouse_report_t r = {
         .report_id = REPORT_ID_MOUSE,
         .report = *report
     };
-    if (usbInterruptIsReady3()) {
-        usbSetInterrupt3((void *)&r, sizeof(vusb_mouse_report_t));
-    }
+    if (!usbInterruptIsReady3())
+        return false;
+    usbSetInterrupt3((void *)&r, sizeof(vusb_mouse_report_t));
+    return true;
 }
 
 
@@ -166,36 +188,34 @@ usbRequest_t    *rq = (void *)data;
 
     if((rq->bmRequestType & USBRQ_TYPE_MASK) == USBRQ_TYPE_CLASS){    /* class request type */
         if(rq->bRequest == USBRQ_HID_GET_REPORT){
-            debug("GET_REPORT:");
+            log_debug(PROTOCOL, "GET_REPORT:");
             /* we only have one report type, so don't look at wValue */
             usbMsgPtr = (void *)keyboard_report;
             return sizeof(*keyboard_report);
         }else if(rq->bRequest == USBRQ_HID_GET_IDLE){
-            debug("GET_IDLE: ");
-            //debug_hex(vusb_idle_rate);
+            log_debug(PROTOCOL, "GET_IDLE: ");
             usbMsgPtr = &vusb_idle_rate;
             return 1;
         }else if(rq->bRequest == USBRQ_HID_SET_IDLE){
             vusb_idle_rate = rq->wValue.bytes[1];
-            debug("SET_IDLE: ");
-            debug_hex(vusb_idle_rate);
+            log_debug(PROTOCOL, "SET_IDLE: %02X", vusb_idle_rate);
         }else if(rq->bRequest == USBRQ_HID_SET_REPORT){
-            debug("SET_REPORT: ");
+            log_debug(PROTOCOL, "SET_REPORT: ");
             // Report Type: 0x02(Out)/ReportID: 0x00(none) && Interface: 0(keyboard)
             if (rq->wValue.word == 0x0200 && rq->wIndex.word == 0) {
-                debug("SET_LED: ");
+                log_debug(PROTOCOL, "SET_LED: ");
                 last_req.kind = SET_LED;
                 last_req.len = rq->wLength.word;
             }
             return USB_NO_MSG; // to get data in usbFunctionWrite
         } else {
-            debug("UNKNOWN:");
+            log_debug(PROTOCOL, "UNKNOWN:");
         }
     }else{
-        debug("VENDOR:");
+        log_debug(PROTOCOL, "VENDOR:");
         /* no vendor specific requests implemented */
     }
-    debug("\n");
+    log_debug(PROTOCOL, "\n");
     return 0;   /* default for not implemented requests: return no data back to host */
 }
 
@@ -206,9 +226,7 @@ uchar usbFunctionWrite(uchar *data, uchar len)
     }
     switch (last_req.kind) {
         case SET_LED:
-            debug("SET_LED: ");
-            debug_hex(data[0]);
-            debug("\n");
+            log_debug(PROTOCOL, "SET_LED: %02X\n", data[0]);
             vusb_keyboard_leds = data[0];
             last_req.len = 0;
             return 1;
@@ -444,12 +462,8 @@ USB_PUBLIC usbMsgLen_t usbFunctionDescriptor(struct usbRequest *rq)
     usbMsgLen_t len = 0;
 
 /*
-    debug("usbFunctionDescriptor: ");
-    debug_hex(rq->bmRequestType); debug(" ");
-    debug_hex(rq->bRequest); debug(" ");
-    debug_hex16(rq->wValue.word); debug(" ");
-    debug_hex16(rq->wIndex.word); debug(" ");
-    debug_hex16(rq->wLength.word); debug("\n");
+    log_debug(PROTOCOL, "usbFunctionDescriptor: %02X %02X %04X %04X %04X\n",
+              rq->bmRequestType, rq->bRequest, rq->wValue.word, rq->wIndex.word, rq->wLength.word);
 */
     switch (rq->wValue.bytes[1]) {
 #if USB_CFG_DESCR_PROPS_CONFIGURATION
@@ -303,6 +303,7 @@ OBJDUMP = avr-objdump
 SIZE = avr-size
 AR = avr-ar rcs
 NM = avr-nm
+PYTHON = python
 REMOVE = rm -f
 REMOVEDIR = rmdir
 COPY = cp
@@ -361,6 +362,12 @@ all: begin gccversion sizebefore build sizeafter end
 # Change the build target to build a HEX file or a library.
 build: elf hex eep lss sym
 #build: lib
+ifdef BINLOG_ENABLE
+build: binlog
+endif
+ifdef LOG_REPORT
+build: log_report
+endif
 
 
 elf: $(TARGET).elf
@@ -368,6 +375,7 @@ hex: $(TARGET).hex
 eep: $(TARGET).eep
 lss: $(TARGET).lss
 sym: $(TARGET).sym
+binlog: $(TARGET).binlog
 LIBNAME=lib$(TARGET).a
 lib: $(LIBNAME)
 
@@ -516,6 +524,25 @@ extcoff: $(TARGET).elf
 	@echo $(MSG_SYMBOL_TABLE) $@
 	$(NM) -n $< > $@
 
+# Report flash/RAM saved by log levels against build with all logs enabled.
+LOG_ALL_TARGET = $(TARGET)_logall
+log_report: $(TARGET).elf
+	@echo
+	@echo Log level report:
+	@$(MAKE) -f $(firstword $(MAKEFILE_LIST)) --no-print-directory LOG_LEVEL_ALL_DEBUG=yes TARGET=$(LOG_ALL_TARGET) \
+		OBJDIR=$(OBJDIR)_logall $(LOG_ALL_TARGET).elf > /dev/null
+	@$(SIZE) $(LOG_ALL_TARGET).elf $(TARGET).elf | awk \
+		'NR == 2 { flash = $$1 + $$2; ram = $$2 + $$3 } \
+		 NR == 3 { printf "  flash: %d bytes saved\n  RAM:   %d bytes saved\n", flash - $$1 - $$2, ram - $$2 - $$3 }'
+	$(REMOVE) $(LOG_ALL_TARGET).elf $(LOG_ALL_TARGET).map
+	$(REMOVE) -r $(OBJDIR)_logall
+
+# Create table of binary log format strings, see common/binlog.h.
+%.binlog: %.sym %.hex
+	@echo
+	@echo Creating binary log table: $@
+	$(PYTHON) $(TOP_DIR)/tool/binlog.py table $*.sym $*.hex > $@
+
 
 
 # Create library from object files.
@@ -586,6 +613,7 @@ clean_list :
 	$(REMOVE) $(TARGET).map
 	$(REMOVE) $(TARGET).sym
 	$(REMOVE) $(TARGET).lss
+	$(REMOVE) $(TARGET).binlog
 	$(REMOVE) $(OBJ)
 	$(REMOVE) $(LST)
 	$(REMOVE) $(OBJ:.o=.s)
@@ -608,6 +636,6 @@ $(shell mkdir $(OBJDIR) 2>/dev/null)
 
 # Listing of phony targets.
 .PHONY : all begin finish end sizebefore sizeafter gccversion \
-build elf hex eep lss sym coff extcoff \
+build elf hex eep lss sym binlog log_report coff extcoff \
 clean clean_list debug gdb-config show_path \
 program teensy dfu flip dfu-ee flip-ee dfu-start
@@ -0,0 +1,143 @@
+#!/usr/bin/env python
+"""Binary log table extractor and decoder. See common/binlog.h.
+
+Create table from build outputs(done by 'make binlog'):
+
+    binlog.py table foo.sym foo.hex > foo.binlog
+
+Decode console output:
+
+    hid_listen | binlog.py decode foo.binlog
+"""
+import re
+import sys
+
+SOH = 0x01
+FMT_SYMBOL = '__binlog_fmt'
+SPEC = re.compile(r'%(0?)(-?)(\d*)(l?)([duxXbcs%])')
+
+
+def read_hex(path):
+    """Return flash image of Intel HEX file as dict of address: byte."""
+    flash = {}
+    base = 0
+    for line in open(path):
+        line = line.strip()
+        if not line.startswith(':'):
+            continue
+        data = bytearray.fromhex(line[1:])
+        count, addr, rtype = data[0], (data[1] << 8) | data[2], data[3]
+        if rtype == 0x00:
+            for i in range(count):
+                flash[base + addr + i] = data[4 + i]
+        elif rtype == 0x02:
+            base = ((data[4] << 8) | data[5]) << 4
+        elif rtype == 0x04:
+            base = ((data[4] << 8) | data[5]) << 16
+    return flash
+
+
+def read_string(flash, addr):
+    s = bytearray()
+    while flash.get(addr, 0):
+        s.append(flash[addr])
+        addr += 1
+    return s.decode('latin-1')
+
+
+def table(sym_path, hex_path):
+    flash = read_hex(hex_path)
+    for line in open(sym_path):
+        fields = line.split()
+        if len(fields) != 3 or not fields[2].startswith(FMT_SYMBOL):
+            continue
+        addr = int(fields[0], 16)
+        fmt = read_string(flash, addr)
+        sys.stdout.write('%04X\t%s\n' % (addr & 0xFFFF, fmt.encode('unicode_escape').decode('ascii')))
+
+
+def load_table(path):
+    formats = {}
+    for line in open(path):
+        addr, fmt = line.rstrip('\n').split('\t', 1)
+        formats[int(addr, 16)] = fmt.encode('ascii').decode('unicode_escape')
+    return formats
+
+
+def nargs(fmt):
+    return len([m for m in SPEC.finditer(fmt) if m.group(5) != '%'])
+
+
+def format_record(fmt, args):
+    args = list(args)
+
+    def conv(m):
+        zero, left, width, _, t = m.groups()
+        if t == '%':
+            return '%'
+        v = args.pop(0)
+        if t == 'd':
+            s = str(v - 0x10000 if v & 0x8000 else v)
+        elif t == 'u':
+            s = str(v)
+        elif t == 'x':
+            s = '%x' % v
+        elif t == 'X':
+            s = '%X' % v
+        elif t == 'b':
+            s = bin(v)[2:]
+        elif t == 'c':
+            s = chr(v & 0xFF)
+        else:
+            s = '<%04X>' % v
+        w = int(width or 0)
+        if left:
+            return s.ljust(w)
+        return s.rjust(w, '0' if zero else ' ')
+
+    return SPEC.sub(conv, fmt)
+
+
+def decode(table_path):
+    formats = load_table(table_path)
+    stdin = getattr(sys.stdin, 'buffer', sys.stdin)
+    stdout = sys.stdout
+
+    def read16():
+        v = 0
+        for shift in (0, 6, 12):
+            c = stdin.read(1)
+            if not c:
+                raise EOFError
+            v |= (ord(c) & 0x3F) << shift
+        return v & 0xFFFF
+
+    while True:
+        c = stdin.read(1)
+        if not c:
+            break
+        if ord(c) != SOH:
+            if ord(c):
+                stdout.write(c.decode('latin-1') if isinstance(c, bytes) else c)
+                stdout.flush()
+            continue
+        try:
+            log_id = read16()
+            fmt = formats.get(log_id)
+            if fmt is None:
+                stdout.write('<binlog:%04X?>' % log_id)
+                continue
+            stdout.write(format_record(fmt, [read16() for _ in range(nargs(fmt))]))
+            stdout.flush()
+        except EOFError:
+            break
+
+
+if __name__ == '__main__':
+    if len(sys.argv) == 4 and sys.argv[1] == 'table':
+        table(sys.argv[2], sys.argv[3])
+    elif len(sys.argv) == 3 and sys.argv[1] == 'decode':
+        decode(sys.argv[2])
+    else:
+        sys.stderr.write(__doc__)
+        sys.exit(1)